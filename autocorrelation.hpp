@@ -0,0 +1,64 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Autocorrelation estimates the integrated autocorrelation time of a
+ * scalar series from its most recent values, in units of the series'
+ * spacing (one sweep for Simulation's monitor).
+ *
+ * tau = 1/2 + sum_{t=1}^{W} rho(t), with rho the normalized autocorrelation
+ * function and W Sokal's automatic window: the smallest W with W >= c * tau
+ * (c = 6). Measurements 2 * tau apart are roughly independent.
+ ****/
+
+#include <algorithm>    // std::max
+#include <utility>      // std::move of restored values
+#include <vector>       // Recent values
+
+class Autocorrelation {
+public:
+    // capacity: number of recent values the estimate is based on
+    explicit Autocorrelation(int capacity = 1000) : capacity(capacity) {}
+
+    // Appends a value, dropping the oldest beyond capacity
+    void add(double x) {
+        if (static_cast<int>(series.size()) == capacity) series.erase(series.begin());
+        series.push_back(x);
+    }
+
+    // Integrated autocorrelation time; 1/2 (uncorrelated) until there are enough values
+    double time() const {
+        const int n = series.size();
+        if (n < minValues) return 0.5;
+
+        double mean = 0;
+        for (auto x : series) mean += x;
+        mean /= n;
+        double c0 = 0;
+        for (auto x : series) c0 += (x - mean) * (x - mean);
+        if (c0 == 0) return 0.5;  // Constant series
+
+        double tau = 0.5;
+        for (int t = 1; t < n / 4; t++) {
+            double ct = 0;
+            for (int i = 0; i + t < n; i++) ct += (series[i] - mean) * (series[i + t] - mean);
+            tau += ct / c0 * n / (n - t);
+            if (t >= window * tau) break;
+        }
+        return std::max(tau, 0.5);
+    }
+
+    // Recent values, oldest first, for chain state files
+    const std::vector<double>& values() const noexcept { return series; }
+    void setValues(std::vector<double> v) { series = std::move(v); }
+
+private:
+    // Window factor c of the automatic windowing
+    static constexpr double window = 6;
+
+    // Fewer values than this give no estimate
+    static constexpr int minValues = 20;
+
+    int capacity;
+    std::vector<double> series;
+};
@@ -2,67 +2,85 @@
 /****
  * Bag is an implementation of a set-like data structure.
  * It provides fast (O(1)) add, remove and pick operations.
- * It stores integer values less than N.
- * (Comment from original code, preserved as is)
+ * It stores non-negative integer labels.
+ * (Comment from original code, updated for runtime capacity)
+ *
+ * Storage grows with use: the elements array grows like a vector, and the
+ * label -> position map is split into pages matching the chunks of Pool<T>.
+ * A page is only allocated once a label from its range is added, so a bag
+ * holding a sparse subset of a pool (e.g. order-four vertices) stays small.
  ****/
 #pragma once    // Ensures this header is included only once during compilation
 
 #include <cassert>      // For runtime assertions (e.g., checking bag state)
-#include <random>       // For random number generation in pick()
+#include <memory>       // Owning pointers to index pages
+#include "rng.hpp"      // For random number generation in pick()
+#include "state.hpp"    // Element order in chain state files
+#include <vector>       // Heap storage for index pages and elements
 
-// Template class Bag, parameterized by type T (e.g., Vertex, Triangle) and capacity N
-template <class T, unsigned int N>  // N is the maximum capacity
+// Template class Bag, parameterized by type T (e.g., Vertex, Triangle)
+template <class T>
 class Bag {
     // Alias for T::Label, the integer index type used by Pool<T> (e.g., Vertex::Label)
     using Label = typename T::Label;
 
-private:
-    // Array mapping labels (indices in Pool<T>) to positions in elements
-    // Contains "holes" (EMPTY) for unused slots; size N matches capacity
-    std::array<int, N> indices;
-
-    // Array of active labels, stored contiguously (no holes up to size_)
-    // Size N, but only size_ elements are valid
-    std::array<Label, N> elements;
+    // Each index page covers the labels of one pool chunk
+    static constexpr int page_bits = T::chunk_bits;
+    static constexpr int page_size = 1 << page_bits;
 
-    // Maximum number of elements Bag can hold (equals N)
-    unsigned int capacity_;
+private:
+    // Pages mapping labels (indices in Pool<T>) to positions in elements
+    // Contains "holes" (EMPTY) for unused slots; null pages hold no labels at all
+    std::vector<std::unique_ptr<int[]>> pages;
 
-    // Current number of active elements in the Bag
-    unsigned int size_;
+    // Array of active labels, stored contiguously (no holes)
+    std::vector<Label> elements;
 
     // Reference to a random number generator for picking elements
-    std::mt19937& rng;  // Updated to use std::mt19937
+    Rng& rng;
+
+    // Returns the index slot of obj, allocating its page if necessary
+    int& slot(Label obj) {
+        int page = obj >> page_bits;
+        if (page >= static_cast<int>(pages.size())) pages.resize(page + 1);
+        if (!pages[page]) {
+            pages[page].reset(new int[page_size]);
+            for (int i = 0; i < page_size; i++) pages[page][i] = EMPTY;
+        }
+        return pages[page][obj & (page_size - 1)];
+    }
 
 public:
-    // Constructor: initializes Bag with a random engine reference
+    // Constructor: initializes an empty Bag with a random engine reference
     // rng: Random number generator for pick() operation
-    explicit Bag(std::mt19937& rng)
-        : capacity_(N), size_(0), rng(rng) {
-        indices.fill(EMPTY);  // Initialize all indices to EMPTY (-1)
-    }
+    explicit Bag(Rng& rng) : rng(rng) {}
+
+    // Bags refer to their owner's RNG and are never copied
+    Bag(const Bag&) = delete;
+    Bag& operator=(const Bag&) = delete;
 
     // Returns the current number of active elements in the Bag
     // noexcept: Guarantees no exceptions for performance
     int size() const noexcept {
-        return size_;
+        return static_cast<int>(elements.size());
     }
 
     // Checks if a label is present in the Bag
     // obj: Label to check (implicitly converted to int)
-    // Returns true if obj’s index in indices is not EMPTY
+    // Returns true if obj’s page exists and its slot is not EMPTY
     bool contains(Label obj) const {
-        return indices[obj] != EMPTY;  // Uses Label’s int conversion
+        int page = obj >> page_bits;
+        if (page >= static_cast<int>(pages.size()) || !pages[page]) return false;
+        return pages[page][obj & (page_size - 1)] != EMPTY;
     }
 
     // Adds a label to the Bag
     // obj: Label to add (must not already be present)
-    // Places obj at the next free position in elements and updates indices
+    // Places obj at the end of elements and records its position
     void add(Label obj) {
         assert(!contains(obj));  // Ensure obj isn’t already in Bag (checked elsewhere in Universe)
-        indices[obj] = size_;    // Map obj to its position in elements
-        elements[size_] = obj;   // Store obj at the end of active elements
-        size_++;                 // Increment active count
+        slot(obj) = size();      // Map obj to its position in elements
+        elements.push_back(obj); // Store obj at the end of active elements
     }
 
     // Removes a label from the Bag
@@ -70,46 +88,65 @@ public:
     // Moves the last element to obj’s position to maintain contiguity
     void remove(Label obj) {
         assert(contains(obj));  // Ensure obj is in Bag (checked elsewhere in Universe)
-        size_--;               // Decrement active count
 
-        auto index = indices[obj];  // Get obj’s position in elements
-        auto last = elements[size_]; // Get the last active element
+        int& index = slot(obj);     // obj’s position in elements
+        auto last = elements.back(); // Get the last active element
 
         elements[index] = last;  // Replace obj with last element
-        elements[size_] = EMPTY; // Mark old last position as empty
-        indices[last] = index;   // Update last element’s index
-        indices[obj] = EMPTY;    // Mark obj’s slot as empty
+        elements.pop_back();     // Drop the old last position
+        slot(last) = index;      // Update last element’s index
+        index = EMPTY;           // Mark obj’s slot as empty
     }
 
     // Randomly picks and returns a label from the Bag
     // Returns a random active element using uniform distribution
     Label pick() const {
-        assert(size_ > 0);  // Ensure Bag isn’t empty
-        std::uniform_int_distribution<> uniform(0, size_ - 1);  // Range over active elements
-        return elements[uniform(rng)];  // Return randomly selected label
+        assert(size() > 0);  // Ensure Bag isn’t empty
+        return elements[Random::bounded(rng, size())];  // Return randomly selected label
     }
 
     // Logs the current state of elements array for debugging
-    // Prints indices and their corresponding labels up to size_
+    // Prints indices and their corresponding labels
     void log() {
         printf("elements\n");
-        for (int i = 0; i < size_; i++) {
-            printf("%d: %d\n", i, elements[i]);  // Print position and label
+        for (int i = 0; i < size(); i++) {
+            printf("%d: %d\n", i, static_cast<int>(elements[i]));  // Print position and label
         }
         printf("--\n");
     }
 
     //// Iterator for objects stored in a Bag ////
     // Returns pointer to the start of active elements for iteration
-    auto begin() { return &elements[0]; }
+    auto begin() { return elements.data(); }
 
-    // Returns pointer to the end of active elements (past size_)
-    auto end() { return &elements[size_]; }
+    // Returns pointer to the end of active elements
+    auto end() { return elements.data() + elements.size(); }
+
+    // Writes the elements in order; pick() depends on it, so load() restores the same order
+    void save(std::ostream& out) const {
+        std::vector<int> labels(elements.begin(), elements.end());
+        State::put(out, labels);
+    }
+
+    // Fills an empty bag with the elements written by save()
+    void load(std::istream& in) {
+        assert(size() == 0);
+        std::vector<int> labels;
+        State::get(in, labels);
+        for (auto l : labels) add(l);
+    }
+
+    // Read-only iteration, e.g. over the bags of a const Universe
+    auto begin() const { return elements.data(); }
+    auto end() const { return elements.data() + elements.size(); }
 
 private:
     // Enum defining the EMPTY marker for unused slots
-    // -1 indicates an inactive or invalid entry in indices or elements
+    // -1 indicates an inactive or invalid entry in the index pages
     enum : int {
         EMPTY = -1  // Could be constexpr, but enum suffices here
     };
-};
\ No newline at end of file
+};
+
+template <class T> constexpr int Bag<T>::page_bits;
+template <class T> constexpr int Bag<T>::page_size;
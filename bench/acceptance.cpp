@@ -0,0 +1,64 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+/****
+ * Acceptance ratio benchmark.
+ * Times add/delete attempts through Simulation::attemptMove() with flips
+ * switched off, so the acceptance ratios make up as much of each attempt as
+ * the real path allows. The moves use factors cached once per run; the
+ * reference adds the two exp() calls per attempt the moves made before, on
+ * arguments the compiler cannot hoist out of the loop. Blocks of both kinds
+ * alternate, so drift of the geometry or the machine affects them alike.
+ *
+ * usage: acceptance.x [targetVolume] [slices] [attempts] [seed]
+ ****/
+#include <chrono>           // Wall-clock timing
+#include <cmath>            // log(2), exp
+#include <cstdio>           // printf
+#include <cstdlib>          // atoi
+#include "../simulation.hpp"
+#include "../universe.hpp"
+
+int main(int argc, const char * argv[]) {
+    int targetVolume = argc > 1 ? atoi(argv[1]) : 16000;
+    int slices = argc > 2 ? atoi(argv[2]) : 40;
+    long attempts = argc > 3 ? atol(argv[3]) : 20000000;
+    int seed = argc > 4 ? atoi(argv[4]) : 1;
+
+    Universe universe(targetVolume);
+    universe.create(slices);
+    Simulation simulation(universe);
+    simulation.configure(log(2), targetVolume, seed);
+
+    // Grow to the target volume so the timed phase samples at equilibrium size
+    // (add and delete moves alone barely grow the triangulation)
+    while (universe.trianglesAll.size() < targetVolume) simulation.attemptMove();
+
+    simulation.moveFreqs = {1, 0};  // Add and delete moves only
+    simulation.configure(log(2), targetVolume, seed);
+
+    // The exponents as the moves computed them per attempt, opaque to the optimizer
+    volatile double lambda = log(2), epsilon = 0.02;  // Simulation::epsilon
+
+    using Clock = std::chrono::steady_clock;
+    const long block = 1000000;
+    double cachedTime = 0, referenceTime = 0, sum = 0;
+    long accepted = 0;
+    for (long done = 0; done < attempts; done += 2 * block) {
+        auto start = Clock::now();
+        for (long i = 0; i < block; i++) {
+            accepted += simulation.attemptMove() != 0;
+        }
+        auto middle = Clock::now();
+        for (long i = 0; i < block; i++) {
+            sum += exp(-2 * lambda) + exp(2 * epsilon);
+            accepted += simulation.attemptMove() != 0;
+        }
+        referenceTime += std::chrono::duration<double>(Clock::now() - middle).count();
+        cachedTime += std::chrono::duration<double>(middle - start).count();
+    }
+    long timed = (attempts + 2 * block - 1) / (2 * block) * block;  // Attempts of each kind
+
+    printf("volume %d, %ld attempts, %ld accepted\n", universe.trianglesAll.size(), 2 * timed, accepted);
+    printf("cached factors:     %.1f ns/attempt\n", 1e9 * cachedTime / timed);
+    printf("exp() per attempt:  %.1f ns/attempt (checksum %.3f)\n", 1e9 * referenceTime / timed, sum);
+    return 0;
+}
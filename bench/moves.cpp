@@ -0,0 +1,54 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+/****
+ * Move throughput benchmark.
+ * Grows a Universe to the target volume, then times a fixed number of
+ * Monte Carlo move attempts and of bare Bag::pick() calls.
+ * "make bench" builds this against the default RNG (moves.x) and against
+ * std::mt19937 with std distributions (moves-legacy.x) for comparison.
+ *
+ * usage: moves.x [targetVolume] [slices] [attempts] [seed]
+ ****/
+#include <chrono>           // Wall-clock timing
+#include <cmath>            // log(2)
+#include <cstdio>           // printf
+#include <cstdlib>          // atoi
+#include "../simulation.hpp"
+#include "../universe.hpp"
+
+int main(int argc, const char * argv[]) {
+    int targetVolume = argc > 1 ? atoi(argv[1]) : 16000;
+    int slices = argc > 2 ? atoi(argv[2]) : 40;
+    long attempts = argc > 3 ? atol(argv[3]) : 20000000;
+    int seed = argc > 4 ? atoi(argv[4]) : 1;
+
+    Universe universe(targetVolume);
+    universe.create(slices);
+    Simulation simulation(universe);
+    simulation.configure(log(2), targetVolume, seed);
+
+    // Grow to the target volume so the timed phase samples at equilibrium size
+    while (universe.trianglesAll.size() < targetVolume) simulation.attemptMove();
+
+    using Clock = std::chrono::steady_clock;
+
+    auto start = Clock::now();
+    long accepted = 0;
+    for (long i = 0; i < attempts; i++) {
+        accepted += simulation.attemptMove() != 0;
+    }
+    double moveTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    long sum = 0;  // Keeps the picks from being optimised away
+    for (long i = 0; i < attempts; i++) {
+        sum += universe.trianglesAll.pick();
+    }
+    double pickTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("rng: %s\n", CDT_RNG_LEGACY ? "mt19937 + std distributions" :
+                         CDT_RNG_XOSHIRO ? "xoshiro256** + Lemire" : "Philox4x32-10 + Lemire");
+    printf("volume %d, %ld attempts, %ld accepted\n", universe.trianglesAll.size(), attempts, accepted);
+    printf("moves/sec: %.3e (%.1f ns/attempt)\n", attempts / moveTime, 1e9 * moveTime / attempts);
+    printf("picks/sec: %.3e (checksum %ld)\n", attempts / pickTime, sum);
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "checkpoint.hpp"   // Header for Checkpointer
+#include "state.hpp"        // Header of chain state files
+#include <cassert>          // File checks
+#include <cerrno>           // Retrying interrupted writes
+#include <cstdio>           // rename()
+#include <cstdlib>          // exit() when a state file cannot be replaced
+#include <fcntl.h>          // open()
+#include <iostream>         // Logs exported file names
+#include <unistd.h>         // write(), fsync(), close()
+
+namespace {
+
+// Writes data to a temporary file, syncs it and renames it over filename,
+// as TriangulationSnapshot::save() does for geometries
+void replaceFile(const std::string& filename, const std::string& data) {
+    std::string temporary = filename + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);  // Ensure file opened successfully
+    const char* p = data.data();
+    std::size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;  // A signal is no I/O failure, as in writeBinary()
+        if (n < 0) {
+            perror(temporary.c_str());
+            exit(1);
+        }
+        p += n;
+        left -= n;
+    }
+    // Data on disk before the rename makes it visible
+    int synced;
+    while ((synced = fsync(fd)) != 0 && errno == EINTR) {}
+    if (synced != 0) {
+        perror(temporary.c_str());
+        exit(1);
+    }
+    close(fd);
+    if (rename(temporary.c_str(), filename.c_str()) != 0) {
+        perror(filename.c_str());
+        exit(1);
+    }
+}
+
+}  // namespace
+
+// Lets the writer finish the queued checkpoint, then joins it
+Checkpointer::~Checkpointer() {
+    if (!thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+// Captures into the staging buffer, then swaps it with the writer's once the writer is idle
+void Checkpointer::save(const Universe& universe, const std::string& filename_) {
+    save(universe, filename_, "", "");
+}
+
+void Checkpointer::save(const Universe& universe, const std::string& filename_,
+                        std::string state_, const std::string& stateFilename_, OutputWriter* output_) {
+    buffers[staging].capture(universe);  // The writer never touches the staging buffer
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return !queued; });
+    filename = filename_;
+    state.swap(state_);
+    stateFilename = stateFilename_;
+    output = output_;
+    binary = universe.binaryGeometry;
+    staging = 1 - staging;  // The captured buffer now belongs to the writer
+    queued = true;
+    if (!thread.joinable()) thread = std::thread(&Checkpointer::run, this);
+    lock.unlock();
+    wake.notify_one();
+
+    std::cout << filename_ << "\n";  // Log export, as Universe::exportGeometry() does
+}
+
+void Checkpointer::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return !queued; });
+}
+
+// Writes each queued checkpoint without holding the lock
+void Checkpointer::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return queued || stopping; });
+        if (!queued) return;  // Stopping with nothing left to write
+
+        const TriangulationSnapshot& snapshot = buffers[1 - staging];
+        std::string target = filename;
+        bool format = binary;
+        std::string data;
+        data.swap(state);
+        std::string dataTarget = stateFilename;
+        OutputWriter* records = output;
+        lock.unlock();
+
+        snapshot.save(target, format);
+        if (!data.empty()) {  // Never newer than the geometry
+            std::string sealed = State::seal(data);
+            // Records appended before save() are buffered or written by now; sync() covers them
+            if (records) records->sync();
+            replaceFile(dataTarget, sealed);
+        }
+
+        lock.lock();
+        queued = false;
+        done.notify_all();
+    }
+}
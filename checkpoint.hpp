@@ -0,0 +1,74 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Checkpointer writes geometry checkpoints of one chain in the background.
+ * save() captures the triangulation into a staging TriangulationSnapshot
+ * on the sampler's thread, which takes one pass over the bags, and hands it
+ * to a writer thread. The writer serializes it and replaces the file
+ * atomically (TriangulationSnapshot::save()). Meanwhile the sampler
+ * continues.
+ *
+ * There are two snapshots. The writer owns one while the other is staged,
+ * so a capture never waits for disk I/O. Only a save() issued while the
+ * previous one is still being written waits for it.
+ *
+ * A checkpoint may carry the chain state of Simulation::saveState() as
+ * well. The writer seals it, syncs the observable files whose lengths it
+ * records, and replaces it atomically in the same way, after the geometry.
+ ****/
+
+#include <condition_variable>   // Handing snapshots to the writer
+#include <mutex>                // Guards the hand-off
+#include <string>               // File names
+#include <thread>               // Background writer
+#include "snapshot.hpp"         // Staged triangulation copies
+#include "universe.hpp"         // Source of the checkpoints
+#include "writer.hpp"           // Observable files synced before a state is written
+
+class Checkpointer {
+public:
+    Checkpointer() = default;
+
+    // Waits for the last checkpoint to be written
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // Captures the triangulation of universe and queues it for writing to filename
+    // Runs on the thread the Universe is bound to; returns once the capture is done
+    // The format follows universe.binaryGeometry
+    void save(const Universe& universe, const std::string& filename);
+
+    // As above, and writes the state payload, sealed (State::seal()), to stateFilename once the
+    // geometry is on disk and, if given, output has synced the records appended before this call
+    void save(const Universe& universe, const std::string& filename,
+              std::string state, const std::string& stateFilename, OutputWriter* output = nullptr);
+
+    // Blocks until every queued checkpoint is on disk
+    void wait();
+
+private:
+    // Snapshot staged by save() and the one the writer owns
+    TriangulationSnapshot buffers[2];
+    int staging = 0;
+
+    // Guards everything below except thread
+    std::mutex mutex;
+    std::condition_variable wake;   // Signals the writer that a checkpoint is queued
+    std::condition_variable done;   // Signals save() and wait() that the writer is idle
+
+    bool queued = false;            // A checkpoint awaits or is being written
+    bool binary = false;            // Format of the queued checkpoint
+    std::string filename;           // Destination of the queued checkpoint
+    std::string state;              // Chain state of the queued checkpoint, may be empty
+    std::string stateFilename;      // and its destination
+    OutputWriter* output = nullptr; // Files to sync before the state is replaced, may be null
+    bool stopping = false;          // Set by the destructor
+
+    std::thread thread;
+
+    // Main loop of the writer thread
+    void run();
+};
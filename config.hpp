@@ -27,6 +27,11 @@ public:
 		assert(dict.find("importGeom") != dict.end());
 	}
 
+	// Returns true if an optional key was given in the config file
+	bool has(std::string key) const {
+		return dict.find(key) != dict.end();
+	}
+
 	int getInt(std::string key) {
 		return std::stoi(dict[key]);
 	}
@@ -0,0 +1,125 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "ensemble.hpp"     // Header for Ensemble
+#include <cassert>          // Point file must exist
+#include <fstream>          // Reading point files, probing geometry files
+#include <sstream>          // Splitting seed lists and point lines
+#include "logger.hpp"       // Chain progress messages
+#include "simulation.hpp"   // Markov chain of each ensemble member
+#include "thread_pool.hpp"  // Work-stealing scheduler
+#include "universe.hpp"     // Geometry of each ensemble member
+
+// Adds the Cartesian product of parameter points and seeds
+void Ensemble::add(const std::vector<Chain>& points, const std::vector<int>& seeds) {
+    for (auto i = 0u; i < points.size(); i++) {
+        auto p = points[i];
+        p.chain = i;
+        for (int s : seeds) {
+            p.seed = s;
+            chains.push_back(p);
+        }
+    }
+}
+
+// Runs every chain as one task; the pool balances chains of different cost
+void Ensemble::run(unsigned threads) {
+    Log::print<Log::INFO>("Ensemble: ", chains.size(), " chains on ", threads, " threads");
+    ThreadPool pool(threads);
+    for (const auto& c : chains) {
+        pool.submit([this, c] { runChain(c); });
+    }
+    pool.wait();
+    Log::print<Log::INFO>("Ensemble: all chains completed");
+}
+
+// Output identifier of a chain, unique per parameter point and seed
+std::string Ensemble::chainID(const Chain& c) const {
+    return fileID + "-l" + std::to_string(c.lambda) +
+           "-v" + std::to_string(c.targetVolume) +
+           "-t" + std::to_string(c.slices) +
+           "-s" + std::to_string(c.seed);
+}
+
+// Runs one chain start to finish on the calling (worker) thread
+void Ensemble::runChain(const Chain& c) {
+    Universe universe(c.targetVolume);  // Allocates the chain's pools and binds them to this thread
+    universe.sphere = sphere;
+    universe.incremental = incremental;
+    universe.binaryGeometry = binaryGeometry;
+    // Chains may share volume, slices and seed, so tag checkpoints with lambda
+    universe.geometryTag = "l" + std::to_string(c.lambda);
+
+    Simulation simulation(universe);
+    std::string stateFn = universe.getStateFilename(c.targetVolume, c.slices, c.seed);
+    if (resume && std::ifstream(stateFn).good()) {
+        simulation.restore(stateFn);
+    } else if (!warmStart.empty()) {
+        simulation.warmStart(warmStart);
+        if (universe.nSlices != c.slices) {
+            Log::print<Log::ERROR>(warmStart, " has ", universe.nSlices, " slices, chain ", chainID(c),
+                                   " has ", c.slices);
+            return;
+        }
+    } else if (importGeom) {
+        std::string geomFn = universe.getGeometryFilename(c.targetVolume, c.slices, c.seed);
+        if (std::ifstream(geomFn).good()) {
+            universe.importGeometry(geomFn);
+        } else {
+            Log::print<Log::INFO>("No geometry file ", geomFn, ", creating new Universe");
+        }
+    }
+    if (!universe.imported) {
+        universe.create(c.slices);
+    }
+
+    simulation.chain = c.chain;
+    simulation.measureThreads = measureThreads;
+    simulation.outputSync = outputSync;
+    simulation.binaryOutput = binaryOutput;
+    simulation.warmSweeps = warmSweeps;
+    simulation.sweepAttempts = sweepAttempts;
+    simulation.growAttempts = growAttempts;
+    simulation.directedAdjust = directedAdjust;
+    auto observables = factory(chainID(c));
+    for (auto& o : observables) {
+        simulation.addObservable(*o);
+    }
+
+    Log::print<Log::INFO>("Chain ", chainID(c), " started");
+    simulation.start(measurements, c.lambda, c.targetVolume, c.seed);
+    Log::print<Log::INFO>("Chain ", chainID(c), " finished");
+}
+
+// Parses comma-separated seeds and inclusive ranges "a-b"
+std::vector<int> Ensemble::parseSeeds(std::string spec) {
+    std::vector<int> seeds;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        auto dash = item.find('-', 1);  // Position 0 may be a sign
+        if (dash == std::string::npos) {
+            seeds.push_back(std::stoi(item));
+        } else {
+            int first = std::stoi(item.substr(0, dash));
+            int last = std::stoi(item.substr(dash + 1));
+            for (int s = first; s <= last; s++) seeds.push_back(s);
+        }
+    }
+    return seeds;
+}
+
+// Reads "lambda targetVolume slices" lines, skipping comments and blank lines
+std::vector<Ensemble::Chain> Ensemble::readPoints(std::string fname) {
+    std::ifstream infile(fname);
+    assert(infile.is_open());
+
+    std::vector<Chain> points;
+    std::string line;
+    while (std::getline(infile, line)) {
+        line = line.substr(0, line.find('#'));
+        std::stringstream ss(line);
+        Chain c{0, 0, 0, 0};
+        if (ss >> c.lambda >> c.targetVolume >> c.slices) points.push_back(c);
+    }
+    return points;
+}
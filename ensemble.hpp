@@ -0,0 +1,101 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * An Ensemble runs many independent Markov chains in one process.
+ * Each chain is a (lambda, targetVolume, slices, seed) point with its own
+ * Universe, Simulation and observables, run as one task on a work-stealing
+ * ThreadPool. Chains write to their own output files, named with the
+ * ensemble fileID followed by the chain's parameters.
+ ****/
+
+#include <functional>       // Observable factory
+#include <memory>           // Owning pointers to observables
+#include <string>           // File identifiers
+#include <vector>           // Chain and observable lists
+#include "observable.hpp"   // Observables created per chain
+
+class Ensemble {
+public:
+    // Parameters of a single chain
+    struct Chain {
+        double lambda;      // Cosmological constant
+        int targetVolume;   // Target number of triangles
+        int slices;         // Number of time slices
+        int seed;           // RNG seed
+        int chain = 0;      // Chain id of the RNG key, distinguishes points sharing a seed
+    };
+
+    // Creates the observables of one chain, writing to files tagged with fileID
+    using ObservableFactory = std::function<std::vector<std::unique_ptr<Observable>>(const std::string& fileID)>;
+
+    // fileID: prefix of all output identifiers, measurements: sweeps per chain,
+    // sphere/importGeom: as in the config file, factory: observables per chain
+    Ensemble(std::string fileID, int measurements, bool sphere, bool importGeom, ObservableFactory factory)
+        : fileID(fileID), measurements(measurements), sphere(sphere), importGeom(importGeom), factory(factory) {}
+
+    // Chains patch their neighbor lists in place (Universe::incremental)
+    bool incremental = false;
+
+    // Measurement workers of each chain (Simulation::measureThreads), on top of the chain threads
+    int measureThreads = 0;
+
+    // Seconds between fsyncs of each chain's observable files (Simulation::outputSync)
+    double outputSync = 0;
+
+    // Chains write binary series files (Simulation::binaryOutput)
+    bool binaryOutput = false;
+
+    // Chains write binary geometry files (Universe::binaryGeometry)
+    bool binaryGeometry = false;
+
+    // Chains with a state file continue from it (Simulation::restore()) instead of importing
+    bool resume = false;
+
+    // State or geometry file all chains without a state of their own start from
+    // (Simulation::warmStart()), empty to grow each chain from scratch
+    std::string warmStart;
+
+    // Minimum thermalization sweeps of warm-started chains (Simulation::warmSweeps)
+    int warmSweeps = 10;
+
+    // Move attempts per sweep and per growth step, 0 for the defaults
+    // (Simulation::sweepAttempts, Simulation::growAttempts)
+    int sweepAttempts = 0;
+    int growAttempts = 0;
+
+    // Volume adjustment by moves towards targetVolume only, biased (Simulation::directedAdjust)
+    bool directedAdjust = false;
+
+    // Adds one chain to the ensemble
+    void add(Chain c) { chains.push_back(c); }
+
+    // Adds a chain for every combination of parameter point and seed
+    // points: chains whose seed field is ignored, seeds: seeds to run each point with
+    // Each chain's RNG chain id is the index of its point, so results do not depend on seed order
+    void add(const std::vector<Chain>& points, const std::vector<int>& seeds);
+
+    // Runs all chains on the given number of threads and returns when all have finished
+    void run(unsigned threads);
+
+    // Output identifier of a chain, e.g. "run-l0.693147-v16000-t100-s1"
+    std::string chainID(const Chain& c) const;
+
+    // Parses a seed list such as "1-100", "1,2,5" or "1-10,20"
+    static std::vector<int> parseSeeds(std::string spec);
+
+    // Reads parameter points, one "lambda targetVolume slices" triple per line
+    // Text after '#' is ignored
+    static std::vector<Chain> readPoints(std::string fname);
+
+private:
+    std::string fileID;
+    int measurements;
+    bool sphere;
+    bool importGeom;
+    ObservableFactory factory;
+    std::vector<Chain> chains;
+
+    // Builds, thermalizes and measures a single chain on the calling thread
+    void runChain(const Chain& c);
+};
@@ -0,0 +1,180 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Graph is a compressed sparse row (CSR) adjacency structure used by the
+ * observables. Nodes are numbered densely 0..size()-1 in the order of the
+ * node list it was built from (e.g. Universe::vertices), and the neighbors
+ * of node i are neighbors[offsets[i]] .. neighbors[offsets[i + 1] - 1], in
+ * the same order as the per-label lists they were copied from.
+ *
+ * Two flat arrays replace one heap allocation per node, so a breadth-first
+ * search reads memory sequentially and can mark visits in an array of
+ * size() entries instead of one sized by the largest pool label.
+ * The arrays are reused between builds and only grow.
+ *
+ * BFSWorkspace holds the visited marks and frontiers of a breadth-first
+ * search over a Graph, kept between searches. A node counts as visited when
+ * its mark equals the current epoch, so starting a new search increments
+ * the epoch instead of clearing the marks, and costs O(1) instead of O(N).
+ *
+ * MultiSourceBFS holds the state of bit-parallel searches from up to 64
+ * sources at once (MS-BFS): every node carries one machine word per
+ * array, bit i standing for source i of the batch, so one pass over the
+ * frontier advances all searches by one depth.
+ ****/
+
+#include <algorithm>    // std::fill on epoch wrap-around
+#include <cassert>      // Label/id consistency checks
+#include <cstdint>      // 64-bit source masks
+#include <vector>       // Offsets, neighbors and the id maps
+
+class Graph {
+public:
+    // Offsets into neighbors, size() + 1 entries
+    std::vector<int> offsets;
+
+    // Dense ids of the neighbors of all nodes, concatenated
+    std::vector<int> neighbors;
+
+    // Pool label of each dense id
+    std::vector<int> labels;
+
+    // Dense id of each pool label, -1 for labels not in the graph
+    std::vector<int> ids;
+
+    // Number of nodes
+    int size() const noexcept { return static_cast<int>(labels.size()); }
+
+    // Range over the neighbors of node i, for range-based for loops
+    struct Range {
+        const int* first;
+        const int* last;
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        int size() const { return static_cast<int>(last - first); }
+    };
+    Range adjacent(int i) const {
+        return {neighbors.data() + offsets[i], neighbors.data() + offsets[i + 1]};
+    }
+
+    // Builds the graph from a node list and neighbor lists indexed by label
+    // nodes: live labels, in the order of the dense ids
+    // lists: lists[label] holds the labels adjacent to label
+    template <class Label>
+    void build(const std::vector<Label>& nodes, const std::vector<std::vector<Label>>& lists) {
+        int n = static_cast<int>(nodes.size());
+
+        // Dense renumbering; stale ids of dead labels are overwritten with -1
+        for (auto l : labels) ids[l] = -1;
+        if (ids.size() < lists.size()) ids.resize(lists.size(), -1);
+        labels.resize(n);
+        for (int i = 0; i < n; i++) {
+            labels[i] = nodes[i];
+            ids[nodes[i]] = i;
+        }
+
+        offsets.resize(n + 1);
+        neighbors.clear();
+        offsets[0] = 0;
+        for (int i = 0; i < n; i++) {
+            for (auto l : lists[nodes[i]]) {
+                assert(ids[l] >= 0);  // Neighbors must be live nodes
+                neighbors.push_back(ids[l]);
+            }
+            offsets[i + 1] = static_cast<int>(neighbors.size());
+        }
+    }
+};
+
+// Reusable state of breadth-first searches over a Graph
+class BFSWorkspace {
+public:
+    // Frontiers of the current and next depth, as dense ids
+    std::vector<int> thisDepth;
+    std::vector<int> nextDepth;
+
+    // Starts a new search over a graph of n nodes: all nodes unvisited, frontiers empty
+    void start(int n) {
+        if (static_cast<int>(marks.size()) < n) marks.resize(n, epoch);
+        if (++epoch == 0) {  // Epoch wrapped: old marks could alias, so clear once
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+        thisDepth.clear();
+        nextDepth.clear();
+    }
+
+    // Marks node i as visited; returns false if it already was
+    bool visit(int i) {
+        if (marks[i] == epoch) return false;
+        marks[i] = epoch;
+        return true;
+    }
+
+    // Checks whether node i has been visited in the current search
+    bool visited(int i) const { return marks[i] == epoch; }
+
+    // Makes the next depth the current one
+    void advance() {
+        thisDepth.swap(nextDepth);
+        nextDepth.clear();
+    }
+
+private:
+    // Epoch at which each node was last visited
+    std::vector<unsigned> marks;
+    unsigned epoch = 0;
+};
+
+// Reusable state of bit-parallel breadth-first searches from up to 64 sources
+// All words are 0 between batches; start() only grows the arrays
+class MultiSourceBFS {
+public:
+    // Sources per batch, one bit each
+    static const int width = 64;
+
+    // Sources that have reached each node
+    std::vector<std::uint64_t> seen;
+
+    // Sources with each node on their current / next frontier
+    std::vector<std::uint64_t> visit;
+    std::vector<std::uint64_t> visitNext;
+
+    // Nodes with a nonzero visit / visitNext word
+    std::vector<int> thisDepth;
+    std::vector<int> nextDepth;
+
+    // Nodes with a nonzero seen word, for reset()
+    std::vector<int> reached;
+
+    // Target flags by dense id; whoever sets flags clears them again after use
+    std::vector<char> targets;
+
+    // Makes room for a graph of n nodes
+    void start(int n) {
+        if (static_cast<int>(seen.size()) < n) {
+            seen.resize(n, 0);
+            visit.resize(n, 0);
+            visitNext.resize(n, 0);
+            targets.resize(n, 0);
+        }
+    }
+
+    // Makes the next depth the current one
+    void advance() {
+        for (auto v : thisDepth) visit[v] = 0;
+        visit.swap(visitNext);
+        thisDepth.swap(nextDepth);
+        nextDepth.clear();
+    }
+
+    // Clears the words touched by the last batch
+    void reset() {
+        for (auto v : reached) seen[v] = 0;
+        for (auto v : thisDepth) visit[v] = 0;
+        reached.clear();
+        thisDepth.clear();
+        nextDepth.clear();
+    }
+};
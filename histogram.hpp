@@ -0,0 +1,60 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Histogram counts how many vertices have each coordination number and
+ * keeps track of the largest one in use, so the maximum over all vertices
+ * is available without a scan (Simulation::thermalize()).
+ *
+ * add() raises the maximum directly. remove() lowers it to the next
+ * occupied bin once its own bin empties; coordination numbers change by
+ * one per move, so the bins below the maximum are rarely empty and the
+ * walk is short. move() does both for a value that changes, which is what
+ * the moves do, and never has to walk when the value changes by one.
+ ****/
+
+#include <cassert>      // Removal from an empty bin
+#include <vector>       // Counts per coordination number
+
+class Histogram {
+public:
+    // Counts one more value k >= 0
+    void add(int k) {
+        if (k >= static_cast<int>(counts.size())) counts.resize(k + 1, 0);
+        counts[k]++;
+        if (k > top) top = k;
+    }
+
+    // Counts one value k less; k must have been added
+    void remove(int k) {
+        assert(k < static_cast<int>(counts.size()) && counts[k] > 0);
+        counts[k]--;
+        while (top > 0 && counts[top] == 0) top--;
+    }
+
+    // Replaces a counted value from by to
+    void move(int from, int to) {
+        if (to >= static_cast<int>(counts.size())) counts.resize(to + 1, 0);
+        assert(counts[from] > 0);
+        counts[from]--;
+        counts[to]++;
+        if (to > top) top = to;
+        else while (counts[top] == 0) top--;
+    }
+
+    // Largest value counted, 0 if there are none
+    int max() const noexcept { return top; }
+
+    // Number of values equal to k
+    int count(int k) const noexcept { return k < static_cast<int>(counts.size()) ? counts[k] : 0; }
+
+    // Forgets all values
+    void clear() {
+        counts.clear();
+        top = 0;
+    }
+
+private:
+    std::vector<int> counts;
+    int top = 0;
+};
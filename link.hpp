@@ -11,7 +11,7 @@ class Triangle;
 // Link class, inheriting from Pool for memory allocation
 class Link : public Pool<Link> {
 public:
-    // Maximum number of links in the pool (10 million, matching Vertex pool_size)
+    // Upper limit on the number of links in a pool (10 million, matching Vertex pool_size)
     static const unsigned pool_size = 10000000;
 
     // Returns the label of the "final" vertex (endpoint) of the link
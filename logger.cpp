@@ -0,0 +1,93 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "logger.hpp"   // Header for Log and MoveTrace
+#include <csignal>      // Signal handling for crash and on-demand dumps
+#include <unistd.h>     // write(), async-signal-safe output
+
+// Ring buffer storage, zero-initialized so unwritten slots have seq == 0
+MoveEvent MoveTrace::events[MoveTrace::capacity];
+std::atomic<std::uint64_t> MoveTrace::head{0};
+
+constexpr bool MoveTrace::enabled;
+constexpr unsigned MoveTrace::capacity;
+
+namespace {
+
+// Appends the decimal representation of x to buf, returns new end
+// printf is not async-signal-safe, so numbers are formatted by hand
+char* appendInt(char* buf, long long x) {
+    char tmp[24];
+    int n = 0;
+    bool negative = x < 0;
+    unsigned long long u = negative ? -static_cast<unsigned long long>(x) : x;
+    do {
+        tmp[n++] = static_cast<char>('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (negative) *buf++ = '-';
+    while (n > 0) *buf++ = tmp[--n];
+    return buf;
+}
+
+char* appendStr(char* buf, const char* s) {
+    while (*s) *buf++ = *s++;
+    return buf;
+}
+
+void onSignal(int sig) {
+    MoveTrace::dump(2);
+    if (sig == SIGUSR1) return;     // On-demand dump, keep running
+
+    // Restore the default action and re-raise so the process still crashes
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+}  // namespace
+
+// Writes the buffered events, oldest first, to fd
+void MoveTrace::dump(int fd) {
+    static const char* names[] = {"none", "add", "delete", "flip"};
+    char line[128];
+    char* p = appendStr(line, "move trace (last ");
+
+    std::uint64_t end = head.load(std::memory_order_acquire);
+    std::uint64_t begin = end > capacity ? end - capacity : 0;
+    p = appendInt(p, static_cast<long long>(end - begin));
+    p = appendStr(p, " of ");
+    p = appendInt(p, static_cast<long long>(end));
+    p = appendStr(p, " events)\n");
+    if (write(fd, line, p - line) < 0) return;
+
+    for (std::uint64_t i = begin; i < end; i++) {
+        const MoveEvent& e = events[i & (capacity - 1)];
+        // Skip slots that are being overwritten by a concurrent writer
+        if (e.seq.load(std::memory_order_acquire) != i + 1) continue;
+        int label = e.label.load(std::memory_order_relaxed);
+        int volume = e.volume.load(std::memory_order_relaxed);
+        int move = e.move.load(std::memory_order_relaxed);
+        bool accepted = e.accepted.load(std::memory_order_relaxed);
+        // A writer that started meanwhile has cleared seq before touching the fields
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.seq.load(std::memory_order_relaxed) != i + 1) continue;
+
+        p = appendInt(line, static_cast<long long>(i));
+        p = appendStr(p, " ");
+        p = appendStr(p, move < 4 ? names[move] : "?");
+        p = appendStr(p, accepted ? " accepted " : " rejected ");
+        p = appendInt(p, label);
+        p = appendStr(p, " ");
+        p = appendInt(p, volume);
+        p = appendStr(p, "\n");
+        if (write(fd, line, p - line) < 0) return;
+    }
+}
+
+// Installs the crash and on-demand dump handlers (no-op when tracing is off)
+void MoveTrace::installHandlers() {
+    if (!enabled) return;
+    std::signal(SIGSEGV, onSignal);
+    std::signal(SIGABRT, onSignal);
+    std::signal(SIGFPE, onSignal);
+    std::signal(SIGBUS, onSignal);
+    std::signal(SIGUSR1, onSignal);
+}
@@ -0,0 +1,115 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Compile-time gated logging and an in-memory move trace.
+ *
+ * Log::print<L>(...) writes a line to std::cout only if L <= CDT_LOG_LEVEL.
+ * The level is a compile-time constant, so disabled calls are empty inline
+ * functions and vanish from optimized builds. Select the level with
+ * `make LOGLEVEL=<n>` (0 none, 1 error, 2 info, 3 debug, 4 trace).
+ *
+ * MoveTrace is an optional lock-free ring buffer holding the most recent
+ * Monte Carlo move events. It is compiled in with `make TRACE=1` and is
+ * dumped on demand (MoveTrace::dump(), SIGUSR1) or when the program crashes.
+ ****/
+
+#include <atomic>       // Lock-free ring buffer head
+#include <cstdint>      // Fixed-width integers for trace events
+#include <iostream>     // Log output stream
+
+#ifndef CDT_LOG_LEVEL
+#define CDT_LOG_LEVEL 2     // Default: errors and phase-level information
+#endif
+
+#ifndef CDT_MOVE_TRACE
+#define CDT_MOVE_TRACE 0    // Move trace ring buffer disabled by default
+#endif
+
+namespace Log {
+
+// Verbosity levels, ordered from least to most verbose
+enum Level : int {
+    NONE = 0,   // No output
+    ERROR = 1,  // Unexpected states that do not abort the run
+    INFO = 2,   // Phase-level progress (grow, thermalize, sweeps)
+    DEBUG = 3,  // Per-sweep internals (prepare, volume adjustment)
+    TRACE = 4   // Every individual Monte Carlo move
+};
+
+// Compile-time verbosity threshold
+constexpr int level = CDT_LOG_LEVEL;
+
+// Printer<false> swallows its arguments; Printer<true> streams them to std::cout
+template <bool enabled>
+struct Printer {
+    template <typename... Args>
+    static void print(const Args&...) {}
+};
+
+template <>
+struct Printer<true> {
+    template <typename... Args>
+    static void print(const Args&... args) {
+        // Expand the parameter pack left to right into the stream
+        int expand[] = {0, ((std::cout << args), 0)...};
+        (void) expand;
+        std::cout << '\n';
+    }
+};
+
+// Writes one line at verbosity L, compiled out entirely when L > level
+template <int L, typename... Args>
+inline void print(const Args&... args) {
+    Printer<(L <= level)>::print(args...);
+}
+
+}  // namespace Log
+
+// Single entry in the move trace ring buffer
+// Every field is atomic, as dump() may read a slot while record() rewrites it
+// (a seqlock: seq is cleared while the fields change and set once they are written)
+struct MoveEvent {
+    std::atomic<std::uint64_t> seq;  // Sequence number + 1 (0 marks an unwritten or changing slot)
+    std::atomic<std::int32_t> label;     // Label of the simplex the move acted on (-1 if none)
+    std::atomic<std::int32_t> volume;    // Number of triangles after the move
+    std::atomic<std::uint8_t> move;      // Move type: 1 add, 2 delete, 3 flip
+    std::atomic<std::uint8_t> accepted;  // 1 if accepted, 0 if rejected
+};
+
+class MoveTrace {
+public:
+    // Compile-time switch, set with -DCDT_MOVE_TRACE=1
+    static constexpr bool enabled = CDT_MOVE_TRACE != 0;
+
+    // Number of events retained (power of two)
+    static constexpr unsigned capacity = 1u << 16;
+
+    // Records a move event; wait-free and safe to call from several threads
+    static void record(int move, bool accepted, int label, int volume) {
+        if (!enabled) return;
+        std::uint64_t i = head.fetch_add(1, std::memory_order_relaxed);
+        MoveEvent& e = events[i & (capacity - 1)];
+        // Mark the slot as changing before any field does
+        e.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        e.label.store(label, std::memory_order_relaxed);
+        e.volume.store(volume, std::memory_order_relaxed);
+        e.move.store(static_cast<std::uint8_t>(move), std::memory_order_relaxed);
+        e.accepted.store(accepted ? 1 : 0, std::memory_order_relaxed);
+        // Publish the slot last so dump() can detect torn entries
+        e.seq.store(i + 1, std::memory_order_release);
+    }
+
+    // Writes the buffered events, oldest first, to a file descriptor
+    // Only uses async-signal-safe calls so it can run inside a signal handler
+    static void dump(int fd = 2);
+
+    // Installs handlers that dump the trace on SIGSEGV, SIGABRT, SIGFPE, SIGBUS
+    // and on SIGUSR1 (on-demand dump without terminating)
+    static void installHandlers();
+
+private:
+    static MoveEvent events[capacity];
+    static std::atomic<std::uint64_t> head;
+};
@@ -7,6 +7,8 @@
 #include "universe.hpp"      // Represents the CDT geometry and state
 #include "simulation.hpp"    // Manages Monte Carlo simulation logic
 #include "observable.hpp"    // Base class for measurable quantities
+#include "logger.hpp"        // Move trace crash/on-demand dumps
+#include "ensemble.hpp"      // Many chains per process (ensembleSeeds)
 #include "observables/volume_profile.hpp"   // Observable: volume per time slice
 #include "observables/hausdorff.hpp"        // Observable: Hausdorff dimension
 #include "observables/hausdorff_dual.hpp"   // Dual lattice Hausdorff dimension (unused here)
@@ -15,8 +17,28 @@
 #include "observables/riccih.hpp"           // Horizontal Ricci curvature (unused here)
 #include "observables/ricciv.hpp"           // Vertical Ricci curvature (unused here)
 #include <algorithm>            // For std::find and std::accumulate
+#include <fstream>              // Checking for a state file to resume
+#include <memory>               // Owning pointers to observables
+#include <thread>               // Default ensemble thread count
+
+// Creates the observables measured by every chain, writing to files tagged with fID
+// Add or remove observables here
+std::vector<std::unique_ptr<Observable>> makeObservables(const std::string& fID) {
+    std::vector<std::unique_ptr<Observable>> observables;
+    observables.emplace_back(new VolumeProfile(fID));  // Volume profile observable with fileID
+    observables.emplace_back(new Hausdorff(fID));      // Hausdorff dimension observable
+    return observables;
+}
+
+// Reads a measurement interval: a number of sweeps, or "auto" (0) to follow the autocorrelation time
+int readInterval(const std::string& value) {
+    return value == "auto" ? 0 : std::stoi(value);
+}
 
 int main(int argc, const char * argv[]) {
+    // Dump the move trace on crash or SIGUSR1 (only active when built with TRACE=1)
+    MoveTrace::installHandlers();
+
     // Variable to store config file name from command line
     std::string fname;
 
@@ -35,47 +57,136 @@ int main(int argc, const char * argv[]) {
     int targetVolume = cfr.getInt("targetVolume");     // Target number of triangles
     int slices = cfr.getInt("slices");                 // Number of time slices
     std::string sphereString = cfr.getString("sphere"); // String flag for spherical topology
+    bool sphere = false;                               // Boolean to control spherical topology
     if (sphereString == "true") {                      // Check if spherical topology is enabled
-        Universe::sphere = true;                       // Set static flag in Universe class
+        sphere = true;
         printf("sphere\n");                            // Confirm spherical mode
     }
 
     int seed = cfr.getInt("seed");                     // RNG seed for reproducibility
     std::string fID = cfr.getString("fileID");         // File identifier for output
-    int measurements = cfr.getInt("measurements");     // Number of observable measurements
+    int measurements = cfr.getInt("measurements");     // Number of measurement sweeps
     std::string impGeomString = cfr.getString("importGeom"); // String flag for geometry import
     bool impGeom = false;                              // Boolean to control geometry import
     if (impGeomString == "true") impGeom = true;       // Enable import if "true"
+    // incrementalPrepare (optional): patch the neighbor lists in place between sweeps (links and graphs are still rebuilt)
+    bool incremental = cfr.has("incrementalPrepare") && cfr.getString("incrementalPrepare") == "true";
+    // measureThreads (optional): workers measuring observables alongside the next sweep, default 0
+    int measureThreads = cfr.has("measureThreads") ? cfr.getInt("measureThreads") : 0;
+    // outputSync (optional): seconds between fsyncs of the observable files, default 0 (only at checkpoints)
+    double outputSync = cfr.has("outputSync") ? cfr.getDouble("outputSync") : 0;
+    // geometryFormat (optional): "text" (default) or "binary" geometry files (see snapshot.hpp)
+    bool binaryGeometry = cfr.has("geometryFormat") && cfr.getString("geometryFormat") == "binary";
+    // outputFormat (optional): "text" (default) or "binary" series files (see series.hpp)
+    bool binaryOutput = cfr.has("outputFormat") && cfr.getString("outputFormat") == "binary";
+    // resume (optional): "true" continues the chain from its last checkpoint's state file, if any
+    bool resume = cfr.has("resume") && cfr.getString("resume") == "true";
+    // warmStart (optional): state or geometry file of an equilibrated chain at a nearby point
+    // to start from, relaxed for at least warmSweeps (optional, default 10) sweeps
+    std::string warmStart = cfr.has("warmStart") ? cfr.getString("warmStart") : "";
+    int warmSweeps = cfr.has("warmSweeps") ? cfr.getInt("warmSweeps") : 10;
+    // sweepAttempts (optional): move attempts per sweep, default 100 * targetVolume
+    // growAttempts (optional): move attempts per growth step, default 10 * targetVolume
+    int sweepAttempts = cfr.has("sweepAttempts") ? cfr.getInt("sweepAttempts") : 0;
+    int growAttempts = cfr.has("growAttempts") ? cfr.getInt("growAttempts") : 0;
+    // volumeAdjust (optional): "chain" (default) or "directed" (biased) moves to reach targetVolume after a sweep
+    bool directedAdjust = cfr.has("volumeAdjust") && cfr.getString("volumeAdjust") == "directed";
+    // interval (optional): sweeps between measurements of every observable, or "auto", default 1
+    // interval.<name> (optional): the same for one observable, e.g. "interval.hausdorff 10"
+    int interval = cfr.has("interval") ? readInterval(cfr.getString("interval")) : 1;
+    auto observablesFor = [&cfr, interval](const std::string& id) {
+        auto observables = makeObservables(id);
+        for (auto& o : observables) {
+            std::string key = "interval." + o->name;
+            o->interval = cfr.has(key) ? readInterval(cfr.getString(key)) : interval;
+        }
+        return observables;
+    };
+
+    // Ensemble mode: run many chains in this process
+    // ensembleSeeds: seed list such as "1-100" or "1,2,5"
+    // ensemblePoints (optional): file of "lambda targetVolume slices" lines, default is the config point
+    // threads (optional): worker threads, default is the number of hardware threads
+    if (cfr.has("ensembleSeeds")) {
+        std::vector<Ensemble::Chain> points = {{lambda, targetVolume, slices, seed}};
+        if (cfr.has("ensemblePoints")) points = Ensemble::readPoints(cfr.getString("ensemblePoints"));
+        unsigned threads = cfr.has("threads") ? cfr.getInt("threads") : std::thread::hardware_concurrency();
+
+        Ensemble ensemble(fID, measurements, sphere, impGeom, observablesFor);
+        ensemble.incremental = incremental;
+        ensemble.measureThreads = measureThreads;
+        ensemble.outputSync = outputSync;
+        ensemble.binaryOutput = binaryOutput;
+        ensemble.binaryGeometry = binaryGeometry;
+        ensemble.resume = resume;
+        ensemble.warmStart = warmStart;
+        ensemble.warmSweeps = warmSweeps;
+        ensemble.sweepAttempts = sweepAttempts;
+        ensemble.growAttempts = growAttempts;
+        ensemble.directedAdjust = directedAdjust;
+        ensemble.add(points, Ensemble::parseSeeds(cfr.getString("ensembleSeeds")));
+        ensemble.run(threads);
 
-    // Attempt to import existing geometry if specified
-    if (impGeom) {
+        printf("end\n");
+        return 0;
+    }
+
+    // The triangulation sampled by this run (owns its pools, bags and RNG)
+    Universe universe(targetVolume);                   // Pools sized for targetVolume, grown on demand
+    universe.sphere = sphere;                          // Set spherical flag on the Universe
+    universe.incremental = incremental;                // Incremental measurement data updates
+    universe.binaryGeometry = binaryGeometry;          // Geometry file format
+
+    // Markov chain sampling this Universe
+    Simulation simulation(universe);
+
+    // Resume the saved chain if asked and a state file exists, otherwise import or create
+    std::string stateFn = universe.getStateFilename(targetVolume, slices, seed);
+    if (resume && std::ifstream(stateFn).good()) {
+        simulation.restore(stateFn);                   // Triangulation, counter and moveFreqs
+    } else if (warmStart != "") {
+        simulation.warmStart(warmStart);               // Triangulation of another point
+        if (universe.nSlices != slices) {
+            printf("%s has %d slices, not %d\n", warmStart.c_str(), universe.nSlices, slices);
+            return 1;
+        }
+    } else if (impGeom) {                              // Attempt to import existing geometry
         // Generate expected geometry filename based on parameters
-        std::string geomFn = Universe::getGeometryFilename(targetVolume, slices, seed);
+        std::string geomFn = universe.getGeometryFilename(targetVolume, slices, seed);
         if (geomFn != "") {                            // If a matching file exists
-            Universe::importGeometry(geomFn);          // Load geometry from geom/ directory
+            universe.importGeometry(geomFn);           // Load geometry from geom/ directory
         } else {                                       // If no file is found
             printf("No suitable geometry file found. Creating new Universe...\n");
         }
     }
 
     // If no geometry was imported, create a new Universe
-    if (Universe::imported == false) {
-        Universe::create(slices);                      // Initialize CDT with given slices
+    if (universe.imported == false) {
+        universe.create(slices);                       // Initialize CDT with given slices
     }
 
-    // Register observables for simulation
-    VolumeProfile vp(fID);                             // Volume profile observable with fileID
-    Simulation::addObservable(vp);                     // Add to simulation for measurement
+    // chain (optional): RNG chain id, e.g. to rerun one chain of an ensemble on its own
+    if (cfr.has("chain")) simulation.chain = cfr.getInt("chain");
+    simulation.measureThreads = measureThreads;        // Concurrent measurements, 0 for in turn
+    simulation.outputSync = outputSync;                // fsync cadence of the observable files
+    simulation.binaryOutput = binaryOutput;            // Binary series instead of text files
+    simulation.warmSweeps = warmSweeps;                // Relaxation after a warm start
+    simulation.sweepAttempts = sweepAttempts;          // Sweep length, 0 for 100 * targetVolume
+    simulation.growAttempts = growAttempts;            // Growth step length, 0 for 10 * targetVolume
+    simulation.directedAdjust = directedAdjust;        // Volume adjustment after each sweep
 
-    Hausdorff haus(fID);                               // Hausdorff dimension observable
-    Simulation::addObservable(haus);                   // Add to simulation
+    // Register observables for simulation
+    auto observables = observablesFor(fID);
+    for (auto& o : observables) {
+        simulation.addObservable(*o);                  // Add to simulation for measurement
+    }
 
     // Print seed for logging/debugging
     printf("seed: %d\n", seed);
     printf("lambda: %f, targetVolume: %d, slices: %d, seed: %d\n", lambda, targetVolume, slices, seed);
     
     // Launch the Monte Carlo simulation
-    Simulation::start(measurements, lambda, targetVolume, seed);
+    simulation.start(measurements, lambda, targetVolume, seed);
     // Parameters: number of measurements, cosmological constant, target volume, seed
 
     // Signal completion
@@ -1,86 +1,105 @@
 // Copyright 2020 Joren Brunekreef and Andrzej Görlich
-#include <fstream>      // For file I/O operations (reading/writing output files)
+#include <cassert>      // Checks that the output file is open
+#include <cstring>      // memcpy of binary values
 #include <vector>       // For storing vertex/triangle labels in sphere and distance methods
-#include <algorithm>    // Unused here, possibly intended for future sorting operations
+#include <algorithm>    // std::min for batch sizes
+#include "state.hpp"    // Chain state files
 #include "observable.hpp" // Header for Observable class, defining interface and base members
 
-// Initialize static RNG for random selection (e.g., in randomVertex(), randomTriangle())
-// Currently seeded with 0; TODO suggests proper seeding needed
-std::default_random_engine Observable::rng(0);  // TODO(JorenB): seed properly
-
-// Writes the computed observable data to a file
-// Appends output string to a file named using data_dir, name, identifier, and extension
+// Queues the record as one line or row of the observable's file
+// The writer keeps the file open and writes it in batches from its own thread
 void Observable::write() {
-    // Construct filename (e.g., "out/VolumeProfile-collab-16000-1.dat")
-    std::string filename = data_dir + name + "-" + identifier + extension;
-
-    // Check if file exists and is readable (logic seems inverted; good() is true if OK)
-    std::ifstream infile(filename);
-    if (!infile.good()) {  // If file doesn’t exist or isn’t readable, exit with error
-        printf("output file deleted\n");  // Likely a debug message; behavior seems odd
-        exit(1);
+    assert(file >= 0);  // clear() must have opened the file
+
+    if (!binary) {
+        // Same formatting as std::to_string: integers in full, reals with 6 decimals
+        std::string line;
+        for (double value : record) {
+            line += type == Series::Int ? std::to_string(static_cast<long long>(value)) : std::to_string(value);
+            line += " ";
+        }
+        if (!line.empty()) line.pop_back();  // Remove trailing space
+        writer->append(file, line);
+        return;
     }
-    infile.close();
 
-    // Open file in append mode to add new measurement data
-    std::ofstream file;
-    file.open(filename, std::ios::out | std::ios::app);
-
-    assert(file.is_open());  // Ensure file opened successfully
-
-    file << output << "\n";  // Write output string followed by newline
-    file.close();            // Close file
+    if (columns == 0) {
+        columns = record.size();
+        auto header = Series::header(type, columns, name, identifier, parameters);
+        writer->append(file, header.data(), header.size());
+    }
+    assert(record.size() == columns);  // Rows have a fixed width
+
+    // Values are stored in host order, which Series::header() checked to be little-endian
+    row.resize(8 * columns);
+    for (auto i = 0u; i < columns; i++) {
+        if (type == Series::Int) {
+            std::int64_t value = static_cast<std::int64_t>(record[i]);
+            std::memcpy(&row[8 * i], &value, 8);
+        } else {
+            std::memcpy(&row[8 * i], &record[i], 8);
+        }
+    }
+    writer->append(file, row.data(), row.size());
 }
 
-// Clears the observable’s output file by truncating it
+// Clears the observable's output file by truncating it
 // Resets file to empty state for new simulation runs
 void Observable::clear() {
-    // Construct filename (same as write())
-    std::string filename = data_dir + name + "-" + identifier + extension;
+    // Construct filename (e.g., "out/VolumeProfile-collab-16000-1.dat")
+    std::string filename = data_dir + name + "-" + identifier + (binary ? ".cdts" : extension);
+    file = writer->open(filename);
+    columns = 0;  // The header is written with the first record
+}
 
-    // Open file in truncate mode to erase contents
-    std::ofstream file;
-    file.open(filename, std::ios::out | std::ios::trunc);
+// The RNG, the file length as appended so far and the columns of a binary file
+void Observable::saveState(std::ostream& out) const {
+    assert(file >= 0);
+    State::put(out, Random::state(rng));
+    State::put(out, writer->size(file));
+    State::put(out, static_cast<std::uint64_t>(columns));
+}
 
-    assert(file.is_open());  // Ensure file opened successfully
+void Observable::loadState(std::istream& in) {
+    std::string state;
+    State::get(in, state);
+    Random::restore(rng, state);
+    State::get(in, resumeSize);
+    std::uint64_t c = 0;
+    State::get(in, c);
+    columns = c;
+}
 
-    file.close();  // Close file (empty now)
+// Keeps the first resumeSize bytes of the file, including the header of a binary file
+void Observable::resume() {
+    std::string filename = data_dir + name + "-" + identifier + (binary ? ".cdts" : extension);
+    file = writer->open(filename, resumeSize);
 }
 
 // Computes a metric sphere of given radius around a vertex using BFS
 // origin: Starting vertex, radius: Maximum link distance
 // Returns vector of vertices at exactly radius hops away (Sec. 3.4)
 std::vector<Vertex::Label> Observable::sphere(Vertex::Label origin, int radius) {
-    std::vector<bool> done;              // Tracks visited vertices
-    std::vector<Vertex::Label> thisDepth; // Current depth’s vertices
-    std::vector<Vertex::Label> nextDepth; // Next depth’s vertices
-
-    // Find maximum vertex label to size done array
-    int vmax = 0;
-    for (auto v : Universe::vertices) {
-        if (v > vmax) vmax = v;
-    }
-    done.resize(vmax + 1, false);  // Initialize all as unvisited
+    const Graph& g = geometry->vertexGraph;  // Dense adjacency of the vertices
+    bfs.start(g.size());  // O(1): bumps the visited epoch, keeps the storage
 
-    done.at(origin) = true;        // Mark origin as visited
-    thisDepth.push_back(origin);   // Start BFS from origin
+    bfs.visit(g.ids[origin]);               // Mark origin as visited
+    bfs.thisDepth.push_back(g.ids[origin]); // Start BFS from origin
 
     std::vector<Vertex::Label> vertexList;  // Result: vertices at radius
 
     // Iterate through depths up to radius
     for (int currentDepth = 0; currentDepth < radius; currentDepth++) {
-        for (auto v : thisDepth) {  // Explore neighbors at current depth
-            for (auto neighbor : Universe::vertexNeighbors[v]) {
-                if (!done.at(neighbor)) {  // If neighbor unvisited
-                    nextDepth.push_back(neighbor);  // Add to next depth
-                    done.at(neighbor) = true;       // Mark as visited
+        for (auto v : bfs.thisDepth) {  // Explore neighbors at current depth
+            for (auto neighbor : g.adjacent(v)) {
+                if (bfs.visit(neighbor)) {  // If neighbor unvisited, mark it
+                    bfs.nextDepth.push_back(neighbor);  // Add to next depth
                     if (currentDepth == radius - 1)  // If at target radius
-                        vertexList.push_back(neighbor);  // Add to result
+                        vertexList.push_back(g.labels[neighbor]);  // Add to result
                 }
             }
         }
-        thisDepth = nextDepth;  // Move to next depth
-        nextDepth.clear();      // Clear for next iteration
+        bfs.advance();  // Move to next depth
     }
 
     return vertexList;  // Return vertices at radius
@@ -90,36 +109,26 @@ std::vector<Vertex::Label> Observable::sphere(Vertex::Label origin, int radius)
 // origin: Starting triangle, radius: Maximum dual link distance
 // Returns vector of triangles at exactly radius hops away (Sec. 3.4)
 std::vector<Triangle::Label> Observable::sphereDual(Triangle::Label origin, int radius) {
-    std::vector<bool> done;                // Tracks visited triangles
-    std::vector<Triangle::Label> thisDepth; // Current depth’s triangles
-    std::vector<Triangle::Label> nextDepth; // Next depth’s triangles
-
-    // Find maximum triangle label to size done array
-    int tmax = 0;
-    for (auto t : Universe::triangles) {
-        if (t > tmax) tmax = t;
-    }
-    done.resize(tmax + 1, false);  // Initialize all as unvisited
+    const Graph& g = geometry->triangleGraph;  // Dense adjacency of the dual lattice
+    bfs.start(g.size());  // O(1): bumps the visited epoch, keeps the storage
 
-    done.at(origin) = true;        // Mark origin as visited
-    thisDepth.push_back(origin);   // Start BFS from origin
+    bfs.visit(g.ids[origin]);               // Mark origin as visited
+    bfs.thisDepth.push_back(g.ids[origin]); // Start BFS from origin
 
     std::vector<Triangle::Label> triangleList;  // Result: triangles at radius
 
     // Iterate through depths up to radius
     for (int currentDepth = 0; currentDepth < radius; currentDepth++) {
-        for (auto t : thisDepth) {  // Explore neighbors at current depth
-            for (auto neighbor : Universe::triangleNeighbors[t]) {
-                if (!done.at(neighbor)) {  // If neighbor unvisited
-                    nextDepth.push_back(neighbor);  // Add to next depth
-                    done.at(neighbor) = true;       // Mark as visited
+        for (auto t : bfs.thisDepth) {  // Explore neighbors at current depth
+            for (auto neighbor : g.adjacent(t)) {
+                if (bfs.visit(neighbor)) {  // If neighbor unvisited, mark it
+                    bfs.nextDepth.push_back(neighbor);  // Add to next depth
                     if (currentDepth == radius - 1)  // If at target radius
-                        triangleList.push_back(neighbor);  // Add to result
+                        triangleList.push_back(g.labels[neighbor]);  // Add to result
                 }
             }
         }
-        thisDepth = nextDepth;  // Move to next depth
-        nextDepth.clear();      // Clear for next iteration
+        bfs.advance();  // Move to next depth
     }
 
     return triangleList;  // Return triangles at radius
@@ -131,35 +140,26 @@ std::vector<Triangle::Label> Observable::sphereDual(Triangle::Label origin, int
 int Observable::distance(Vertex::Label v1, Vertex::Label v2) {
     if (v1 == v2) return 0;  // Same vertex: distance is 0
 
-    std::vector<bool> done;              // Tracks visited vertices
-    std::vector<Vertex::Label> thisDepth; // Current depth’s vertices
-    std::vector<Vertex::Label> nextDepth; // Next depth’s vertices
-
-    // Find maximum vertex label to size done array
-    int vmax = 0;
-    for (auto v : Universe::vertices) {
-        if (v > vmax) vmax = v;
-    }
-    done.resize(vmax + 1, false);  // Initialize all as unvisited
+    const Graph& g = geometry->vertexGraph;  // Dense adjacency of the vertices
+    bfs.start(g.size());  // O(1): bumps the visited epoch, keeps the storage
+    int target = g.ids[v2];
 
-    done.at(v1) = true;        // Mark start vertex as visited
-    thisDepth.push_back(v1);   // Start BFS from v1
+    bfs.visit(g.ids[v1]);               // Mark start vertex as visited
+    bfs.thisDepth.push_back(g.ids[v1]); // Start BFS from v1
 
     int currentDepth = 0;      // Track depth (distance)
     do {
-        for (auto v : thisDepth) {  // Explore neighbors at current depth
-            for (auto neighbor : Universe::vertexNeighbors[v]) {
-                if (neighbor == v2) return currentDepth + 1;  // Found target: return distance
-                if (!done.at(neighbor)) {  // If neighbor unvisited
-                    nextDepth.push_back(neighbor);  // Add to next depth
-                    done.at(neighbor) = true;       // Mark as visited
+        for (auto v : bfs.thisDepth) {  // Explore neighbors at current depth
+            for (auto neighbor : g.adjacent(v)) {
+                if (neighbor == target) return currentDepth + 1;  // Found target: return distance
+                if (bfs.visit(neighbor)) {  // If neighbor unvisited, mark it
+                    bfs.nextDepth.push_back(neighbor);  // Add to next depth
                 }
             }
         }
-        thisDepth = nextDepth;  // Move to next depth
-        nextDepth.clear();      // Clear for next iteration
-        currentDepth++;         // Increment distance
-    } while (thisDepth.size() > 0);  // Continue until no more vertices to explore
+        bfs.advance();  // Move to next depth
+        currentDepth++;             // Increment distance
+    } while (bfs.thisDepth.size() > 0);  // Continue until no more vertices to explore
 
     return -1;  // Unreachable (shouldn’t happen in connected CDT geometry)
 }
@@ -170,35 +170,182 @@ int Observable::distance(Vertex::Label v1, Vertex::Label v2) {
 int Observable::distanceDual(Triangle::Label t1, Triangle::Label t2) {
     if (t1 == t2) return 0;  // Same triangle: distance is 0
 
-    std::vector<bool> done;                // Tracks visited triangles
-    std::vector<Triangle::Label> thisDepth; // Current depth’s triangles
-    std::vector<Triangle::Label> nextDepth; // Next depth’s triangles
+    const Graph& g = geometry->triangleGraph;  // Dense adjacency of the dual lattice
+    bfs.start(g.size());  // O(1): bumps the visited epoch, keeps the storage
+    int target = g.ids[t2];
 
-    // Find maximum triangle label to size done array
-    int tmax = 0;
-    for (auto t : Universe::triangles) {
-        if (t > tmax) tmax = t;
-    }
-    done.resize(tmax + 1, false);  // Initialize all as unvisited
-
-    done.at(t1) = true;        // Mark start triangle as visited
-    thisDepth.push_back(t1);   // Start BFS from t1
+    bfs.visit(g.ids[t1]);               // Mark start triangle as visited
+    bfs.thisDepth.push_back(g.ids[t1]); // Start BFS from t1
 
     int currentDepth = 0;      // Track depth (distance)
     do {
-        for (auto t : thisDepth) {  // Explore neighbors at current depth
-            for (auto neighbor : Universe::triangleNeighbors[t]) {
-                if (neighbor == t2) return currentDepth + 1;  // Found target: return distance
-                if (!done.at(neighbor)) {  // If neighbor unvisited
-                    nextDepth.push_back(neighbor);  // Add to next depth
-                    done.at(neighbor) = true;       // Mark as visited
+        for (auto t : bfs.thisDepth) {  // Explore neighbors at current depth
+            for (auto neighbor : g.adjacent(t)) {
+                if (neighbor == target) return currentDepth + 1;  // Found target: return distance
+                if (bfs.visit(neighbor)) {  // If neighbor unvisited, mark it
+                    bfs.nextDepth.push_back(neighbor);  // Add to next depth
                 }
             }
         }
-        thisDepth = nextDepth;  // Move to next depth
-        nextDepth.clear();      // Clear for next iteration
-        currentDepth++;         // Increment distance
-    } while (thisDepth.size() > 0);  // Continue until no more triangles to explore
+        bfs.advance();  // Move to next depth
+        currentDepth++;             // Increment distance
+    } while (bfs.thisDepth.size() > 0);  // Continue until no more triangles to explore
 
     return -1;  // Unreachable (shouldn’t happen in connected CDT geometry)
 }
+
+// Counts the nodes at each distance 0..maxRadius from origin with one BFS
+// The search stops at maxRadius or when the graph is exhausted (remaining shells are 0)
+std::vector<int> Observable::shells(const Graph& g, int origin, int maxRadius) {
+    std::vector<int> profile(maxRadius + 1, 0);
+    bfs.start(g.size());
+    bfs.visit(origin);
+    bfs.thisDepth.push_back(origin);
+    profile[0] = 1;
+
+    for (int depth = 1; depth <= maxRadius && bfs.thisDepth.size() > 0; depth++) {
+        for (auto v : bfs.thisDepth) {
+            for (auto neighbor : g.adjacent(v)) {
+                if (bfs.visit(neighbor)) bfs.nextDepth.push_back(neighbor);
+            }
+        }
+        profile[depth] = bfs.nextDepth.size();  // Everything found at this depth is new
+        bfs.advance();
+    }
+    return profile;
+}
+
+// Shell sizes around a vertex
+std::vector<int> Observable::shellProfile(Vertex::Label origin, int maxRadius) {
+    const Graph& g = geometry->vertexGraph;
+    return shells(g, g.ids[origin], maxRadius);
+}
+
+// Shell sizes around a triangle in the dual lattice
+std::vector<int> Observable::shellProfileDual(Triangle::Label origin, int maxRadius) {
+    const Graph& g = geometry->triangleGraph;
+    return shells(g, g.ids[origin], maxRadius);
+}
+
+// Shell sizes averaged over k random vertices
+std::vector<double> Observable::averageShellProfile(int maxRadius, int k) {
+    std::vector<double> average(maxRadius + 1, 0.0);
+    for (int i = 0; i < k; i++) {
+        auto profile = shellProfile(randomVertex(), maxRadius);
+        for (int r = 0; r <= maxRadius; r++) average[r] += profile[r];
+    }
+    for (auto& a : average) a /= k;
+    return average;
+}
+
+// Dual shell sizes averaged over k random triangles
+std::vector<double> Observable::averageShellProfileDual(int maxRadius, int k) {
+    std::vector<double> average(maxRadius + 1, 0.0);
+    for (int i = 0; i < k; i++) {
+        auto profile = shellProfileDual(randomTriangle(), maxRadius);
+        for (int r = 0; r <= maxRadius; r++) average[r] += profile[r];
+    }
+    for (auto& a : average) a /= k;
+    return average;
+}
+
+// Distances from every source in s1 to every target in s2 within maxDistance
+// Sources are searched 64 at a time, bit i of a word standing for source first + i.
+// A target reached by new bits at depth d adds d to each of those sources; a source
+// that has reached all targets is dropped from the active mask and stops expanding.
+template <class Label>
+std::vector<Observable::DistanceSum> Observable::batchDistances(const Graph& g, const std::vector<Label>& s1,
+                                                                const std::vector<Label>& s2, int maxDistance) {
+    const int width = MultiSourceBFS::width;
+    std::vector<DistanceSum> result(s1.size());
+    msbfs.start(g.size());
+    for (auto t : s2) msbfs.targets[g.ids[t]] = 1;
+    const long targetCount = s2.size();
+
+    for (std::size_t first = 0; first < s1.size(); first += width) {
+        int batch = static_cast<int>(std::min<std::size_t>(width, s1.size() - first));
+        DistanceSum* sums = &result[first];
+        long remaining[width];      // Targets not yet reached, per source
+        std::uint64_t active = 0;   // Sources still searching
+
+        for (int i = 0; i < batch; i++) {
+            int source = g.ids[s1[first + i]];
+            std::uint64_t bit = std::uint64_t(1) << i;
+            remaining[i] = targetCount;
+            if (msbfs.targets[source]) {  // Source is itself a target, at distance 0
+                sums[i].count++;
+                remaining[i]--;
+            }
+            if (remaining[i] > 0) active |= bit;
+            msbfs.seen[source] = bit;
+            msbfs.visit[source] = bit;
+            msbfs.reached.push_back(source);
+            msbfs.thisDepth.push_back(source);
+        }
+
+        for (int depth = 1; depth <= maxDistance && active != 0; depth++) {
+            for (auto v : msbfs.thisDepth) {
+                std::uint64_t frontier = msbfs.visit[v] & active;
+                if (frontier == 0) continue;
+                for (auto neighbor : g.adjacent(v)) {
+                    std::uint64_t fresh = frontier & ~msbfs.seen[neighbor];  // Sources reaching it first now
+                    if (fresh == 0) continue;
+                    if (msbfs.seen[neighbor] == 0) msbfs.reached.push_back(neighbor);
+                    if (msbfs.visitNext[neighbor] == 0) msbfs.nextDepth.push_back(neighbor);
+                    msbfs.seen[neighbor] |= fresh;
+                    msbfs.visitNext[neighbor] |= fresh;
+
+                    if (msbfs.targets[neighbor]) {
+                        for (std::uint64_t bits = fresh; bits != 0; bits &= bits - 1) {
+                            int i = __builtin_ctzll(bits);
+                            sums[i].sum += depth;
+                            sums[i].count++;
+                            if (--remaining[i] == 0) active &= ~(std::uint64_t(1) << i);
+                        }
+                        frontier &= active;
+                        if (frontier == 0) break;
+                    }
+                }
+            }
+            msbfs.advance();
+        }
+        msbfs.reset();
+    }
+
+    for (auto t : s2) msbfs.targets[g.ids[t]] = 0;  // Leave the flags clear for the next caller
+    return result;
+}
+
+// Per-source vertex distances to a sphere
+std::vector<Observable::DistanceSum> Observable::sourceDistances(const std::vector<Vertex::Label>& s1,
+                                                                 const std::vector<Vertex::Label>& s2, int maxDistance) {
+    return batchDistances(geometry->vertexGraph, s1, s2, maxDistance);
+}
+
+// Per-source dual distances to a set of triangles
+std::vector<Observable::DistanceSum> Observable::sourceDistancesDual(const std::vector<Triangle::Label>& s1,
+                                                                     const std::vector<Triangle::Label>& s2, int maxDistance) {
+    return batchDistances(geometry->triangleGraph, s1, s2, maxDistance);
+}
+
+// Pairwise vertex distances between two spheres
+Observable::DistanceSum Observable::sphereDistances(const std::vector<Vertex::Label>& s1,
+                                                    const std::vector<Vertex::Label>& s2, int maxDistance) {
+    DistanceSum total;
+    for (auto& d : sourceDistances(s1, s2, maxDistance)) {
+        total.sum += d.sum;
+        total.count += d.count;
+    }
+    return total;
+}
+
+// Pairwise dual distances between two sets of triangles
+Observable::DistanceSum Observable::sphereDistancesDual(const std::vector<Triangle::Label>& s1,
+                                                        const std::vector<Triangle::Label>& s2, int maxDistance) {
+    DistanceSum total;
+    for (auto& d : sourceDistancesDual(s1, s2, maxDistance)) {
+        total.sum += d.sum;
+        total.count += d.count;
+    }
+    return total;
+}
@@ -1,9 +1,14 @@
 // Copyright 2020 Joren Brunekreef and Andrzej Görlich
 #pragma once    // Ensures this header is included only once during compilation
 
+#include <istream>      // Chain state input
+#include <ostream>      // Chain state output
 #include <string>       // For std::string (e.g., identifier, output)
 #include <vector>       // For storing vertex/triangle labels in sphere methods
-#include "universe.hpp" // Provides access to Universe’s geometry data (e.g., vertices, triangles)
+#include "snapshot.hpp" // Read-only copy of the geometry data being measured (e.g., vertices, triangles)
+#include "rng.hpp"      // Random number engine and bounded draws
+#include "writer.hpp"   // Buffered output shared by a simulation's observables
+#include "series.hpp"   // Binary output format
 
 // Observable base class for measuring properties of CDT geometries
 class Observable {
@@ -24,24 +29,86 @@ public:
         write();    // Write result to file
     }
 
-    // Clears stored data (e.g., output) to reset for new measurements
+    // Truncates the output file and opens it in the writer for new measurements
     void clear();
 
+    // Writes the RNG state and the length of the output file so far (Simulation::saveState())
+    // No measurement may be running, so that all its records have been appended
+    void saveState(std::ostream& out) const;
+
+    // Reads what saveState() wrote; the RNG continues from there once loaded
+    // (after Simulation::configure() has seeded it)
+    void loadState(std::istream& in);
+
+    // Opens the output file like clear(), but cut back to the length of the loaded state,
+    // dropping records measured after the checkpoint
+    void resume();
+
+    // Write binary series files (series.hpp) instead of text, set by Simulation::start() before clear()
+    bool binary = false;
+
+    // Run parameters stored in the header of binary files, set by Simulation::start()
+    std::string parameters;
+
+    // Measured every interval-th sweep, starting with the first (default: every sweep)
+    // 0 lets the Simulation choose from the autocorrelation time of the volume profile
+    int interval = 1;
+
+    // Sets the snapshot this observable measures and the writer its records go to
+    // (called by Simulation::addObservable())
+    // measure() reads only the snapshot and appends to the writer, so it may run on any thread
+    void attach(const GeometrySnapshot& g, OutputWriter& w) {
+        geometry = &g;
+        writer = &w;
+    }
+
+    // Keys this observable's RNG to its own stream (called by Simulation::configure())
+    // seed, chain: those of the Simulation, stream: Random::Observables + position
+    void seedRNG(std::uint64_t seed, std::uint32_t chain, std::uint32_t stream) {
+        Random::seed(rng, seed, chain, stream);
+    }
+
+    virtual ~Observable() = default;
+
 private:
     // Identifier for output files, set by constructor
     std::string identifier;
 
+    // Writer of the output file and the file's id in it, set by attach() and clear()
+    OutputWriter* writer = nullptr;
+    int file = -1;
+
+    // Columns of the binary file, fixed by its first record; 0 until the header is written
+    std::size_t columns = 0;
+
+    // Length of the output file at the checkpoint loaded by loadState(), used by resume()
+    std::uint64_t resumeSize = 0;
+
+    // Encoded values of a binary record, reused between writes
+    std::vector<char> row;
+
 protected:
-    // Static random number generator shared across all Observable instances
+    // Geometry being measured, set by attach()
+    const GeometrySnapshot* geometry = nullptr;
+
+    // Visited marks and frontiers shared by the BFS toolbox functions, kept between calls
+    BFSWorkspace bfs;
+
+    // Bit-parallel search state of sourceDistances(), kept between calls
+    MultiSourceBFS msbfs;
+
+    // Random number generator owned by this observable, keyed by seedRNG()
     // Used for random vertex/triangle selection
-    static std::default_random_engine rng;
+    Rng rng{0};
 
     // Pure virtual function: derived classes must implement specific measurement logic
-    // Processes Universe data to compute the observable’s value (e.g., volume profile)
+    // Processes the snapshot's data to compute the observable’s value (e.g., volume profile)
     virtual void process() = 0;
 
-    // Writes the computed observable data (from output) to a file
-    // Uses identifier, data_dir, and extension for file naming
+    // Hands the computed observable data (from record) to the writer
+    // Text files get one line of space-separated values per measurement; binary files a
+    // header before the first record, then one row per measurement
+    // The file is named from identifier, data_dir, and extension by clear()
     void write();
 
     // Toolbox: Utility methods for derived classes
@@ -49,44 +116,93 @@ protected:
     // Computes a metric sphere of given radius around a vertex
     // origin: Starting vertex, radius: Distance in link hops
     // Returns vector of vertices within radius (uses BFS, Sec. 3.4)
-    static std::vector<Vertex::Label> sphere(Vertex::Label origin, int radius);
+    std::vector<Vertex::Label> sphere(Vertex::Label origin, int radius);
 
     // Computes a dual metric sphere of given radius around a triangle
     // origin: Starting triangle, radius: Distance in dual link hops
     // Returns vector of triangles within radius (uses BFS, Sec. 3.4)
-    static std::vector<Triangle::Label> sphereDual(Triangle::Label origin, int radius);
+    std::vector<Triangle::Label> sphereDual(Triangle::Label origin, int radius);
 
     // Calculates the shortest link distance between two vertices
     // v1, v2: Vertices to measure distance between
     // Returns number of hops (uses BFS, Sec. 3.4)
-    static int distance(Vertex::Label v1, Vertex::Label v2);
+    int distance(Vertex::Label v1, Vertex::Label v2);
 
     // Calculates the shortest dual link distance between two triangles
     // t1, t2: Triangles to measure distance between
     // Returns number of dual hops (uses BFS, Sec. 3.4)
-    static int distanceDual(Triangle::Label t1, Triangle::Label t2);
+    int distanceDual(Triangle::Label t1, Triangle::Label t2);
+
+    // Counts the vertices at every distance up to maxRadius from origin in one BFS
+    // Returns maxRadius + 1 shell sizes; entry r equals sphere(origin, r).size()
+    std::vector<int> shellProfile(Vertex::Label origin, int maxRadius);
+
+    // Dual lattice version of shellProfile()
+    std::vector<int> shellProfileDual(Triangle::Label origin, int maxRadius);
+
+    // Shell sizes averaged over k random origins (randomVertex()), one BFS each
+    std::vector<double> averageShellProfile(int maxRadius, int k);
+
+    // Dual shell sizes averaged over k random origins (randomTriangle())
+    std::vector<double> averageShellProfileDual(int maxRadius, int k);
+
+    // Sum and count of the distances between all pairs (a, b), a in s1, b in s2
+    // Pairs further apart than maxDistance are left out of both
+    struct DistanceSum {
+        long sum = 0;
+        long count = 0;
+    };
+
+    // Pairwise distances between two vertex sets, summed over all pairs
+    DistanceSum sphereDistances(const std::vector<Vertex::Label>& s1,
+                                const std::vector<Vertex::Label>& s2, int maxDistance);
 
-    // Selects a random vertex from Universe::vertices
+    // Dual lattice version of sphereDistances()
+    DistanceSum sphereDistancesDual(const std::vector<Triangle::Label>& s1,
+                                    const std::vector<Triangle::Label>& s2, int maxDistance);
+
+    // Distances from each vertex of s1 to all vertices of s2, one entry per vertex of s1
+    // Runs bit-parallel BFS over batches of 64 sources; each source stops once it has
+    // reached every vertex of s2, each batch once all its sources have
+    std::vector<DistanceSum> sourceDistances(const std::vector<Vertex::Label>& s1,
+                                             const std::vector<Vertex::Label>& s2, int maxDistance);
+
+    // Dual lattice version of sourceDistances()
+    std::vector<DistanceSum> sourceDistancesDual(const std::vector<Triangle::Label>& s1,
+                                                 const std::vector<Triangle::Label>& s2, int maxDistance);
+
+    // Selects a random vertex from the snapshot's vertices
     // Returns its label using uniform distribution
-    static Vertex::Label randomVertex() {
-        std::uniform_int_distribution<> rv(0, Universe::vertices.size() - 1);
-        return Universe::vertices.at(rv(rng));
+    Vertex::Label randomVertex() {
+        return geometry->vertices.at(Random::bounded(rng, geometry->vertices.size()));
     }
 
-    // Selects a random triangle from Universe::triangles
+    // Selects a random triangle from the snapshot's triangles
     // Returns its label using uniform distribution
-    static Triangle::Label randomTriangle() {
-        std::uniform_int_distribution<> rt(0, Universe::triangles.size() - 1);
-        return Universe::triangles.at(rt(rng));
+    Triangle::Label randomTriangle() {
+        return geometry->triangles.at(Random::bounded(rng, geometry->triangles.size()));
     }
 
     // Directory for output files (default: "out/")
     std::string data_dir = "out/";
 
-    // File extension for output (default: ".dat")
+    // File extension for output (default: ".dat", ".cdts" for binary files)
     std::string extension = ".dat";
 
-    // String buffer storing the observable’s computed data
+    // Values of the observable's last measurement, one per column
     // Populated by process(), written by write()
-    std::string output;
+    std::vector<double> record;
+
+    // Type of the values in record: Series::Int values are written as integers
+    // Derived classes producing non-integer values set Series::Real
+    Series::Type type = Series::Int;
+
+private:
+    // Shell sizes up to maxRadius around dense id origin of g (shared by the profile functions)
+    std::vector<int> shells(const Graph& g, int origin, int maxRadius);
+
+    // Per-source distances from s1 to s2 over g (shared by sourceDistances and its dual)
+    template <class Label>
+    std::vector<DistanceSum> batchDistances(const Graph& g, const std::vector<Label>& s1,
+                                            const std::vector<Label>& s2, int maxDistance);
 };
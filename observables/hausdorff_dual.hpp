@@ -10,8 +10,10 @@ class HausdorffDual : public Observable {
 public:
     // Constructor: initializes the observable with an identifier
     // id: String identifier for output files (e.g., "collab-16000-1")
-    HausdorffDual(std::string id) : Observable(id) {
+    // origins: number of random origins the shell sizes are averaged over
+    HausdorffDual(std::string id, int origins = 1) : Observable(id), origins(origins) {
         name = "hausdorff_dual";  // Set observable name for file naming and identification
+        if (origins > 1) type = Series::Real;  // Averages are real numbers
     }
 
     // Implements the pure virtual process() method from Observable
@@ -23,4 +25,7 @@ private:
     // Maximum epsilon (radius) for dual sphere measurements
     // Used to bound the distance range for Hausdorff dimension calculation
     int max_epsilon;
+
+    // Number of BFS origins per measurement; 1 writes integer shell sizes, more write averages
+    int origins;
 };
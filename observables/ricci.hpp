@@ -15,6 +15,7 @@ public:
     Ricci(std::string id, std::vector<int> epsilons)
         : Observable(id), epsilons(epsilons) {
         name = "ricci";  // Set observable name for file naming and identification
+        type = Series::Real;  // Average distances are real numbers
     }
 
     // Implements the pure virtual process() method from Observable
@@ -4,12 +4,5 @@
 #include <algorithm>            // For std::find and std::accumulate
 
 void VolumeProfile::process() {
-	std::string tmp = "";
-	for (auto l : Universe::sliceSizes) {
-		tmp += std::to_string(l);
-		tmp += " ";
-	}
-	tmp.pop_back();
-
-	output = tmp;
+	record.assign(geometry->sliceSizes.begin(), geometry->sliceSizes.end());
 }
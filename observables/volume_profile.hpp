@@ -16,6 +16,6 @@ public:
 
     // Implements the pure virtual process() method from Observable
     // Computes the volume (number of vertices) for each time slice in the CDT geometry
-    // Stores result in output string for writing (Sec. 3.4)
+    // Stores result in record for writing (Sec. 3.4)
     void process();
 };
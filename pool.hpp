@@ -2,9 +2,9 @@
 #pragma once    // Ensures this header is included only once during compilation
 
 /****
- * A Simplex<T> contains a single pool of objects of type T.
- * There exists only a single copy of a pool for a given type.
- * (Comment from original code, slightly rephrased for clarity)
+ * A Simplex<T> contains a pool of objects of type T.
+ * Each Universe owns one pool per simplex type.
+ * (Comment from original code, updated for per-Universe pools)
  ****/
 
 #include <cstdio>       // For standard I/O (e.g., printf in assertions)
@@ -13,30 +13,139 @@
 #include <random>       // Unused here, included for RNG in derived classes
 #include <string>       // Used for std::to_string in some contexts
 #include <typeinfo>     // Unused here, possibly for debugging type info
+#include <vector>       // Chunk table of an Arena
+#include "state.hpp"    // Arena contents in chain state files
 
 /****
  * Pool is a template class that maintains
- * a single, static pool (array) of objects of given class T.
+ * a pool (array) of objects of given class T.
  * The T class should inherit from Pool<T> to use this mechanism.
  * (Comment from original code, slightly expanded)
+ *
+ * The storage itself lives in a Pool<T>::Arena. Every Universe owns its own
+ * arenas, so several triangulations can coexist in one process. Labels are
+ * plain integers and carry no reference to their arena; instead each thread
+ * has one bound arena per type (see Pool<T>::bind()), and all Label
+ * dereferences and create()/destroy() calls on that thread go to it.
+ * A chain running on its own thread therefore shares no mutable state
+ * with chains on other threads.
+ *
+ * An arena is a table of fixed-size chunks. It starts at the capacity asked
+ * for (e.g. derived from targetVolume) and doubles by appending chunks when
+ * the free list runs out. Chunks never move, so labels and references stay
+ * valid, and the free-list order is the same as for one flat array.
  ****/
 
 template<class T>
 class Pool {
-private:
-    // Static array holding all objects of type T (the pool itself)
-    // Private to prevent external modification; managed via static methods
-    static T *elements;
+public:
+    // Each chunk holds 2^chunk_bits objects
+    static constexpr int chunk_bits = 12;
+    static constexpr int chunk_size = 1 << chunk_bits;
+
+    // Owning storage for one pool of T objects
+    class Arena {
+    public:
+        // Allocates room for at least initialCapacity objects, all initially free
+        explicit Arena(int initialCapacity = 0) {
+            // Ensure child class has defined a valid pool_size
+            static_assert(T::pool_size > 0, "Pool size not defined in child class");
+
+            do {
+                addChunk();
+            } while (capacity < initialCapacity);
+        }
+
+        // Releases the storage and unbinds it from the calling thread if bound
+        ~Arena() {
+            if (Pool<T>::arena == this) Pool<T>::bind(nullptr);
+            for (auto c : chunks) delete[] c;
+        }
 
-    // Index of the first free (inactive) cell in the pool
-    // Points to the next available slot for allocation
-    static int first;
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
 
-    // Number of currently used (active) cells in the pool
-    static int total;
+        // Number of objects the arena can hold before it has to grow
+        int size() const noexcept { return capacity; }
 
-    // Total capacity of the pool, set to T::pool_size at initialization
-    static int capacity;
+        // Writes the cells, free list included, so that load() restores the same labels
+        // and the same order of future create() calls
+        void save(std::ostream& out) const {
+            State::put(out, capacity);
+            State::put(out, first);
+            State::put(out, total);
+            for (auto c : chunks) out.write(reinterpret_cast<const char*>(c), sizeof(T) * chunk_size);
+        }
+
+        // Restores cells written by save() into an unused arena
+        // Chunks beyond the saved capacity keep their initial free list, which is the one
+        // grow() would have appended, so the arena may start out larger than the saved one
+        void load(std::istream& in) {
+            assert(total == 0);
+            int savedCapacity;
+            State::get(in, savedCapacity);
+            State::get(in, first);
+            State::get(in, total);
+            while (capacity < savedCapacity) addChunk();
+            for (int i = 0; i < savedCapacity / chunk_size; i++) {
+                in.read(reinterpret_cast<char*>(chunks[i]), sizeof(T) * chunk_size);
+            }
+            if (Pool<T>::arena == this) Pool<T>::table = chunks.data();  // Table may have moved
+        }
+
+    private:
+        // Table of chunks holding all objects of type T (the pool itself)
+        std::vector<T*> chunks;
+
+        // Index of the first free (inactive) cell in the pool
+        // Points to the next available slot for allocation
+        int first = 0;
+
+        // Number of currently used (active) cells in the pool
+        int total = 0;
+
+        // Total capacity of the pool (chunks.size() * chunk_size)
+        int capacity = 0;
+
+        // Appends one chunk whose cells continue the free list
+        void addChunk() {
+            T* chunk = new T[chunk_size];  // Allocate array of T objects
+            // Initialize all elements as free (inactive)
+            // next is set to ~(i + 1), marking them as available with negative values
+            for (int j = 0; j < chunk_size; j++)
+                chunk[j].next = ~(capacity + j + 1);  // ~x = -(x + 1), avoids negative zero issue
+            chunks.push_back(chunk);
+            capacity += chunk_size;
+        }
+
+        // Doubles the capacity once the free list is exhausted
+        void grow() {
+            // T::pool_size caps the pool as a guard against runaway growth
+            const std::size_t maxChunks = T::pool_size / chunk_size;
+            assert(chunks.size() < maxChunks);
+            for (auto n = chunks.size(); n > 0 && chunks.size() < maxChunks; n--) addChunk();
+            if (Pool<T>::arena == this) Pool<T>::table = chunks.data();  // Table may have moved
+        }
+
+        friend class Pool<T>;
+    };
+
+    // Binds arena a to the calling thread; all Pool<T> operations there use it
+    // nullptr unbinds the current arena
+    static void bind(Arena* a) {
+        arena = a;
+        table = a ? a->chunks.data() : nullptr;
+    }
+
+    // Returns the arena bound to the calling thread (nullptr if none)
+    static Arena* bound() noexcept { return arena; }
+
+private:
+    // Arena bound to the calling thread, managed via bind()
+    static thread_local Arena* arena;
+
+    // Cached arena->chunks.data(), kept separate so Label dereference skips the arena
+    static thread_local T** table;
 
     // Instance-specific index of the next free entry or self-index when active
     // Negative when inactive (using ~ to mark), positive when active (self-referential)
@@ -104,58 +213,45 @@ public:
     // Used when a Pool object is implicitly cast to its Label
     operator Label() const { return Label{next}; }
 
-    // Creates and initializes the static pool of T objects
-    // Called once to allocate the elements array
-    static T* create_pool() {
-        // Ensure child class has defined a valid pool_size
-        static_assert(T::pool_size > 0, "Pool size not defined in child class");
-
-        capacity = T::pool_size;  // Set capacity from child class’s pool_size
-        elements = new T[capacity];  // Allocate array of T objects
-
-        // Initialize all elements as free (inactive)
-        // next is set to ~(i + 1), marking them as available with negative values
-        for (auto i = 0; i < capacity; i++)
-            elements[i].next = ~(i + 1);  // ~x = -(x + 1), avoids negative zero issue
-
-        return elements;  // Return pointer to the allocated pool
-    }
-
-    // Allocates a new T object from the pool
+    // Allocates a new T object from the bound pool
     // Returns its Label (index) and marks it as active
     static Label create() {
-        auto tmp = first;  // Get index of first free cell
-        assert(elements[tmp].next < 0);  // Verify it’s inactive (negative next)
-        first = ~elements[tmp].next;  // Update first to next free index
-        elements[tmp].next = tmp;  // Mark as active by setting next to self
-        total++;  // Increment active count
+        auto tmp = arena->first;  // Get index of first free cell
+        if (tmp == arena->capacity) arena->grow();  // Free list exhausted: add chunks
+        assert(at(tmp).next < 0);  // Verify it’s inactive (negative next)
+        arena->first = ~at(tmp).next;  // Update first to next free index
+        at(tmp).next = tmp;  // Mark as active by setting next to self
+        arena->total++;  // Increment active count
         return tmp;  // Return index as Label (implicit constructor)
     }
 
     // Deallocates a T object, returning it to the free pool
     // i: Label (index) of the object to destroy
     static void destroy(Label i) {
-        elements[i].next = ~first;  // Mark as inactive, linking to previous first
-        first = i;  // Set as new first free cell
-        total--;  // Decrement active count
+        at(i).next = ~arena->first;  // Mark as inactive, linking to previous first
+        arena->first = i;  // Set as new first free cell
+        arena->total--;  // Decrement active count
     }
 
-    // Returns reference to the T object at index i in the pool
-    static T& at(int i) { return elements[i]; }
+    // Returns reference to the T object at index i in the bound pool
+    static T& at(int i) { return table[i >> chunk_bits][i & (chunk_size - 1)]; }
 
-    // Returns the number of currently active objects in the pool
+    // Returns the number of currently active objects in the bound pool
     // noexcept: Guarantees no exceptions for performance
-    static int size() noexcept { return total; }
+    static int size() noexcept { return arena->total; }
+
+    // Returns the total capacity of the bound pool
+    static int pool_capacity() noexcept { return arena->capacity; }
 
-    // Returns the total capacity of the pool
-    static int pool_capacity() noexcept { return capacity; }
+    // Checks whether label i refers to an active object of the bound pool
+    static bool active(int i) { return i >= 0 && i < arena->capacity && at(i).next >= 0; }
 
     //// Checks if the object is indeed in the right position in array 'elements' ////
     // Verifies this object’s index matches its position in the pool
     void check_in_pool() {
         assert(this->next >= 0);  // Must be active (non-negative next)
-        assert(this->next < capacity);  // Index within bounds
-        assert(this == elements + this->next);  // Pointer matches index
+        assert(this->next < arena->capacity);  // Index within bounds
+        assert(this == &at(this->next));  // Pointer matches index
     }
 
     // Destroys this object, returning it to the free pool
@@ -177,7 +273,7 @@ public:
         Iterator(int i = 0, int cnt = 0) : i{i}, cnt{cnt} {}
 
         // Dereference operator: returns reference to current T object
-        T& operator*() { return elements[i]; }
+        T& operator*() { return at(i); }
 
         // Equality operator: compares iteration count
         bool operator==(const Iterator& b) const { return cnt == b.cnt; }
@@ -187,8 +283,8 @@ public:
 
         // Pre-increment operator: advances to next active object
         Iterator& operator++() {
-            if (cnt < total - 1)  // If not at the last active object
-                while (elements[++i].next < 0) continue;  // Skip inactive slots
+            if (cnt < arena->total - 1)  // If not at the last active object
+                while (at(++i).next < 0) continue;  // Skip inactive slots
             cnt++;  // Increment count
             return *this;
         }
@@ -199,13 +295,13 @@ public:
         // Returns iterator to the first active object
         auto begin() {
             int i;
-            for (i = 0; elements[i].next < 0; i++) continue;  // Find first active
+            for (i = 0; at(i).next < 0; i++) continue;  // Find first active
             return Iterator{i, 0};
         }
 
         // Returns iterator to the end (past last active object)
         auto end() {
-            return Iterator{-1, total};
+            return Iterator{-1, arena->total};
         }
     };
 
@@ -214,11 +310,8 @@ public:
 };
 
 // Static member initializations (outside class definition)
-// Allocate and initialize the pool at program start
-template<class T> T* Pool<T>::elements = Pool<T>::create_pool();
-// Initialize first free index to 0
-template<class T> int Pool<T>::first{0};
-// Initialize active object count to 0
-template<class T> int Pool<T>::total{0};
-// Initialize capacity (set by create_pool())
-template<class T> int Pool<T>::capacity;
+// No arena is bound until a Universe binds its own
+template<class T> thread_local typename Pool<T>::Arena* Pool<T>::arena = nullptr;
+template<class T> thread_local T** Pool<T>::table = nullptr;
+template<class T> constexpr int Pool<T>::chunk_bits;
+template<class T> constexpr int Pool<T>::chunk_size;
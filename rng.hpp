@@ -0,0 +1,260 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Random number layer used by Simulation, Universe (via Bag::pick()) and
+ * Observable.
+ *
+ * Rng is the engine type. By default it is Philox4x32-10, a counter-based
+ * generator: output block i is a keyed bijection of the counter
+ * (i, chain, stream), with the seed as key. Every (seed, chain, stream)
+ * triple therefore names its own independent stream, and threads can
+ * draw from different streams without sharing any state. Random::seed()
+ * keys an engine; the stream ids in use are listed in Random::Stream.
+ *
+ * Random::bounded() and Random::uniform() draw from the engine without
+ * constructing distribution objects: bounded integers use Lemire's nearly
+ * divisionless multiply-shift method, and doubles take the top 53 bits.
+ * Neither depends on the standard library's distribution
+ * implementations, so a seed gives the same chain on every platform and
+ * compiler.
+ *
+ * `make RNG=xoshiro` (-DCDT_RNG_XOSHIRO=1) selects xoshiro256**, which is
+ * slightly faster but only hashes (seed, chain, stream) into its initial
+ * state. `make RNG=legacy` (-DCDT_RNG_LEGACY=1) selects std::mt19937 with
+ * std::uniform_*_distribution, the original code path. Both are kept for
+ * benchmarking (see bench/).
+ ****/
+
+#include <cstdint>      // Fixed-width state and outputs
+#include <istream>      // Engine state input
+#include <ostream>      // Engine state output
+#include <random>       // Legacy engine and distributions
+#include <sstream>      // Engine state as a string
+#include <string>       // Engine state as a string
+
+#ifndef CDT_RNG_LEGACY
+#define CDT_RNG_LEGACY 0
+#endif
+#ifndef CDT_RNG_XOSHIRO
+#define CDT_RNG_XOSHIRO 0
+#endif
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+// Counter words 0-1 count blocks, word 2 holds the chain id, word 3 the stream id
+// Satisfies UniformRandomBitGenerator; each block yields two 64-bit outputs
+class Philox {
+public:
+    using result_type = std::uint64_t;
+
+    explicit Philox(std::uint64_t seed = 0, std::uint32_t chain = 0, std::uint32_t stream = 0) {
+        this->seed(seed, chain, stream);
+    }
+
+    // Keys the generator and rewinds it to the first block of the stream
+    void seed(std::uint64_t seed, std::uint32_t chain = 0, std::uint32_t stream = 0) {
+        key[0] = static_cast<std::uint32_t>(seed);
+        key[1] = static_cast<std::uint32_t>(seed >> 32);
+        counter[0] = 0;
+        counter[1] = 0;
+        counter[2] = chain;
+        counter[3] = stream;
+        index = 2;      // Buffer is empty, the next call generates block 0
+    }
+
+    // Returns the next 64 random bits
+    result_type operator()() noexcept {
+        if (index == 2) {
+            generate();
+            index = 0;
+        }
+        return buffer[index++];
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    // Writes and reads the full state as text, like the standard engines
+    friend std::ostream& operator<<(std::ostream& out, const Philox& g) {
+        out << g.key[0] << ' ' << g.key[1];
+        for (auto c : g.counter) out << ' ' << c;
+        return out << ' ' << g.buffer[0] << ' ' << g.buffer[1] << ' ' << g.index;
+    }
+    friend std::istream& operator>>(std::istream& in, Philox& g) {
+        in >> g.key[0] >> g.key[1];
+        for (auto& c : g.counter) in >> c;
+        return in >> g.buffer[0] >> g.buffer[1] >> g.index;
+    }
+
+private:
+    std::uint32_t key[2];
+    std::uint32_t counter[4];   // Counter of the next block to generate
+    std::uint64_t buffer[2];    // Outputs of the current block
+    int index;                  // Next unused output in buffer
+
+    // Encrypts the counter into buffer and advances the block count
+    void generate() noexcept {
+        std::uint32_t x[4] = {counter[0], counter[1], counter[2], counter[3]};
+        std::uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++) {
+            const std::uint64_t p0 = std::uint64_t(0xD2511F53u) * x[0];
+            const std::uint64_t p1 = std::uint64_t(0xCD9E8D57u) * x[2];
+            const std::uint32_t y0 = static_cast<std::uint32_t>(p1 >> 32) ^ x[1] ^ k0;
+            const std::uint32_t y2 = static_cast<std::uint32_t>(p0 >> 32) ^ x[3] ^ k1;
+            x[1] = static_cast<std::uint32_t>(p1);
+            x[3] = static_cast<std::uint32_t>(p0);
+            x[0] = y0;
+            x[2] = y2;
+            k0 += 0x9E3779B9u;  // Weyl sequence key schedule
+            k1 += 0xBB67AE85u;
+        }
+        buffer[0] = (std::uint64_t(x[0]) << 32) | x[1];
+        buffer[1] = (std::uint64_t(x[2]) << 32) | x[3];
+        if (++counter[0] == 0) ++counter[1];
+    }
+};
+
+// xoshiro256** 1.0 (Blackman and Vigna), satisfies UniformRandomBitGenerator
+class Xoshiro256 {
+public:
+    using result_type = std::uint64_t;
+
+    explicit Xoshiro256(std::uint64_t seed = 0) { this->seed(seed); }
+
+    // Expands a 64-bit seed into the 256-bit state with splitmix64
+    void seed(std::uint64_t seed) {
+        for (auto& word : s) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    // Returns the next 64 random bits
+    result_type operator()() noexcept {
+        const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    // Writes and reads the full state as text, like the standard engines
+    friend std::ostream& operator<<(std::ostream& out, const Xoshiro256& g) {
+        return out << g.s[0] << ' ' << g.s[1] << ' ' << g.s[2] << ' ' << g.s[3];
+    }
+    friend std::istream& operator>>(std::istream& in, Xoshiro256& g) {
+        return in >> g.s[0] >> g.s[1] >> g.s[2] >> g.s[3];
+    }
+
+private:
+    std::uint64_t s[4];
+
+    static std::uint64_t rotl(std::uint64_t x, int k) noexcept {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// RngName identifies the engine in chain state files, whose RNG states only it can read
+#if CDT_RNG_LEGACY
+using Rng = std::mt19937;
+constexpr const char* RngName = "mt19937";
+#elif CDT_RNG_XOSHIRO
+using Rng = Xoshiro256;
+constexpr const char* RngName = "xoshiro256";
+#else
+using Rng = Philox;
+constexpr const char* RngName = "philox";
+#endif
+
+namespace Random {
+
+// Stream ids within a chain; observable i of a Simulation uses Observables + i
+enum Stream : std::uint32_t {
+    Simulation = 0,     // Move selection and Metropolis tests
+    Universe = 1,       // Bag::pick() of the Universe's bags
+    Observables = 2     // First observable stream
+};
+
+// Keys g to the stream (seed, chain, stream)
+inline void seed(Philox& g, std::uint64_t seed, std::uint32_t chain, std::uint32_t stream) {
+    g.seed(seed, chain, stream);
+}
+
+// Engines without a counter are seeded with a splitmix64 hash of the triple
+template <class G>
+inline void seed(G& g, std::uint64_t seed, std::uint32_t chain, std::uint32_t stream) {
+    std::uint64_t z = seed ^ ((std::uint64_t(chain) << 32 | stream) * 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    g.seed(static_cast<typename G::result_type>(z ^ (z >> 31)));
+}
+
+// Full state of an engine, for checkpoints; restore() continues the stream exactly
+template <class G>
+inline std::string state(const G& g) {
+    std::ostringstream out;
+    out << g;
+    return out.str();
+}
+
+template <class G>
+inline void restore(G& g, const std::string& state) {
+    std::istringstream in(state);
+    in >> g;
+}
+
+// Uniform integer in [0, n), n > 0
+// Generic engines go through std::uniform_int_distribution (legacy path)
+template <class G>
+inline int bounded(G& g, int n) {
+    std::uniform_int_distribution<> uniform(0, n - 1);
+    return uniform(g);
+}
+
+// Lemire's method: one 32x32 multiply, and a division only in the rare
+// case that the low half of the product falls below n
+// G: an engine producing 64 uniform bits per call
+template <class G>
+inline int lemire(G& g, int n) {
+    const std::uint32_t range = static_cast<std::uint32_t>(n);
+    std::uint64_t m = (g() >> 32) * range;
+    std::uint32_t low = static_cast<std::uint32_t>(m);
+    if (low < range) {
+        const std::uint32_t threshold = -range % range;
+        while (low < threshold) {
+            m = (g() >> 32) * range;
+            low = static_cast<std::uint32_t>(m);
+        }
+    }
+    return static_cast<int>(m >> 32);
+}
+
+inline int bounded(Xoshiro256& g, int n) { return lemire(g, n); }
+inline int bounded(Philox& g, int n) { return lemire(g, n); }
+
+// Uniform double in [0, 1)
+template <class G>
+inline double uniform(G& g) {
+    std::uniform_real_distribution<> uniform(0.0, 1.0);
+    return uniform(g);
+}
+
+inline double uniform(Xoshiro256& g) {
+    return (g() >> 11) * (1.0 / 9007199254740992.0);  // 53 bits / 2^53
+}
+
+inline double uniform(Philox& g) {
+    return (g() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+}  // namespace Random
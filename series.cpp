@@ -0,0 +1,99 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "series.hpp"       // Series format
+#include <cstdio>           // Error messages
+#include <cstdlib>          // exit() on unreadable files
+#include <cstring>          // memcpy of header fields
+#include <fcntl.h>          // open()
+#include <sys/mman.h>       // mmap()
+#include <sys/stat.h>       // File size
+#include <unistd.h>         // close()
+
+namespace Series {
+
+namespace {
+
+const char magic[8] = {'C', 'D', 'T', 'S', 'E', 'R', 'I', 'E'};
+const std::size_t fixedSize = 36;   // Header up to the strings
+
+// The format is little-endian and values are written as they are in memory
+bool littleEndian() {
+    const std::uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+void put(std::string& s, std::size_t offset, std::uint32_t value) {
+    std::memcpy(&s[offset], &value, sizeof(value));
+}
+
+std::uint32_t get(const char* p, std::size_t offset) {
+    std::uint32_t value;
+    std::memcpy(&value, p + offset, sizeof(value));
+    return value;
+}
+
+void fail(const std::string& filename, const char* reason) {
+    fprintf(stderr, "%s: %s\n", filename.c_str(), reason);
+    exit(1);
+}
+
+}  // namespace
+
+// Fixed fields, the strings, then padding to 8 bytes so rows stay aligned in a mapping
+std::string header(Type type, std::uint32_t columns, const std::string& name,
+                   const std::string& identifier, const std::string& parameters) {
+    if (!littleEndian()) fail(name, "binary output needs a little-endian host");
+
+    std::size_t size = fixedSize + name.size() + identifier.size() + parameters.size();
+    size = (size + 7) / 8 * 8;
+    std::string h(size, '\0');
+    std::memcpy(&h[0], magic, sizeof(magic));
+    put(h, 8, version);
+    put(h, 12, type);
+    put(h, 16, columns);
+    put(h, 20, size);
+    put(h, 24, name.size());
+    put(h, 28, identifier.size());
+    put(h, 32, parameters.size());
+    h.replace(fixedSize, name.size(), name);
+    h.replace(fixedSize + name.size(), identifier.size(), identifier);
+    h.replace(fixedSize + name.size() + identifier.size(), parameters.size(), parameters);
+    return h;
+}
+
+// Maps the whole file; rows are read in place
+Reader::Reader(const std::string& filename) {
+    if (!littleEndian()) fail(filename, "binary input needs a little-endian host");
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) fail(filename, "cannot open");
+    struct stat st;
+    fstat(fd, &st);
+    mapSize = st.st_size;
+    if (mapSize < fixedSize) fail(filename, "not a series file");
+    map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) fail(filename, "cannot map");
+
+    const char* p = static_cast<const char*>(map);
+    if (std::memcmp(p, magic, sizeof(magic)) != 0) fail(filename, "not a series file");
+    if (get(p, 8) != version) fail(filename, "unsupported series version");
+    type = static_cast<Type>(get(p, 12));
+    columns = get(p, 16);
+    std::size_t dataOffset = get(p, 20);
+    std::size_t nameLength = get(p, 24), identifierLength = get(p, 28), parametersLength = get(p, 32);
+    if (dataOffset > mapSize || fixedSize + nameLength + identifierLength + parametersLength > dataOffset)
+        fail(filename, "corrupt series header");
+
+    name.assign(p + fixedSize, nameLength);
+    identifier.assign(p + fixedSize + nameLength, identifierLength);
+    parameters.assign(p + fixedSize + nameLength + identifierLength, parametersLength);
+
+    data = p + dataOffset;
+    nRows = columns > 0 ? (mapSize - dataOffset) / (8 * columns) : 0;
+}
+
+Reader::~Reader() {
+    munmap(map, mapSize);
+}
+
+}  // namespace Series
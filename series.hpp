@@ -0,0 +1,86 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Binary format of observable series (outputFormat binary).
+ *
+ * A series file is a header followed by fixed-width rows, one per
+ * measurement, appended as the run goes. Every row has the same number of
+ * columns and all values have the same type: 64-bit signed integers or
+ * 64-bit IEEE doubles, little-endian. Doubles are stored exactly, where the
+ * text format keeps the 6 decimals of std::to_string.
+ *
+ * Header, all integers uint32 little-endian:
+ *   0   magic "CDTSERIE"
+ *   8   version (1)
+ *   12  type (Series::Int or Series::Real)
+ *   16  columns per row
+ *   20  dataOffset: header size in bytes, a multiple of 8
+ *   24  lengths of name, identifier and parameters
+ *   36  the three strings, then zero padding up to dataOffset
+ * The parameters are "key=value" pairs separated by spaces, e.g.
+ * "lambda=0.693147 targetVolume=16000 slices=100 seed=1 chain=0".
+ *
+ * Rows = (file size - dataOffset) / (8 * columns); a row cut short by a
+ * crash is ignored. Series::Reader maps a file read-only and gives direct
+ * access to the rows; tools/series2text converts a file back to text.
+ ****/
+
+#include <cstddef>      // Sizes
+#include <cstdint>      // Fixed-width header fields and values
+#include <string>       // Header strings
+
+namespace Series {
+
+// Type of the values of a series
+enum Type : std::uint32_t { Int = 0, Real = 1 };
+
+// Current version of the format
+const std::uint32_t version = 1;
+
+// Encodes a header for rows of the given type and number of columns
+std::string header(Type type, std::uint32_t columns, const std::string& name,
+                   const std::string& identifier, const std::string& parameters);
+
+// Read-only memory-mapped view of a series file
+class Reader {
+public:
+    // Maps the file and checks its header; exits with a message if it is not a series file
+    explicit Reader(const std::string& filename);
+
+    // Unmaps the file
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    Type type;
+    std::uint32_t columns;
+    std::string name;
+    std::string identifier;
+    std::string parameters;
+
+    // Number of complete rows
+    std::size_t rows() const { return nRows; }
+
+    // Values of a row, valid for type Int and Real respectively
+    const std::int64_t* ints(std::size_t row) const {
+        return reinterpret_cast<const std::int64_t*>(data) + row * columns;
+    }
+    const double* reals(std::size_t row) const {
+        return reinterpret_cast<const double*>(data) + row * columns;
+    }
+
+    // Value at a row and column as a double, for either type
+    double at(std::size_t row, std::uint32_t column) const {
+        return type == Int ? static_cast<double>(ints(row)[column]) : reals(row)[column];
+    }
+
+private:
+    void* map = nullptr;        // Start of the mapping
+    std::size_t mapSize = 0;    // Size of the file
+    const char* data = nullptr; // First row
+    std::size_t nRows = 0;
+};
+
+}  // namespace Series
@@ -2,223 +2,480 @@
 #include "simulation.hpp"
 #include <vector>           // Used for storing observable pointers and volume data
 #include <algorithm>        // For std::find and std::accumulate
-#include <iostream>         // Added for std::cout debugging output
+#include "logger.hpp"       // Compile-time gated logging and move trace
+#include "state.hpp"        // Chain state files
+#include <cassert>          // File checks
+#include <cmath>            // std::ceil of the automatic interval
+#include <cstdlib>          // exit() on unusable state files
+#include <cstring>          // memcmp of the state file magic
+#include <fstream>          // Reading state files
+#include <iterator>         // Reading state files whole
+#include <sstream>          // Building and parsing chain states
+
+namespace {
+
+// Stops a resumed run that cannot continue the saved chain
+void stateError(const std::string& filename, const std::string& message) {
+    printf("%s: %s\n", filename.c_str(), message.c_str());
+    exit(1);
+}
 
-// Initialize static members of Simulation class
-std::default_random_engine Simulation::rng(0);  // Random number generator, initially seeded with 0
-int Simulation::targetVolume = 0;               // Target number of triangles, set by start()
-double Simulation::lambda = 0;                  // Cosmological constant, set by start() (typically ln(2) for 2D CDT)
-int Simulation::seed = 0;                       // RNG seed for reproducibility, set by start()
-double Simulation::epsilon = 0.02;              // Volume-fixing term strength (S_fix = epsilon * (N - targetVolume)^2)
-std::vector<Observable*> Simulation::observables; // Vector of registered observables (e.g., VolumeProfile)
-std::array<int, 2> Simulation::moveFreqs = {1, 1}; // Frequency of move types: [0] add/delete, [1] flip
+}  // namespace
 
 // Starts the Monte Carlo simulation with specified parameters
 void Simulation::start(int measurements, double lambda_, int targetVolume_, int seed_) {
-    targetVolume = targetVolume_;    // Set target number of triangles
-    lambda = lambda_;                // Set cosmological constant
+    configure(lambda_, targetVolume_, seed_);
+    output.syncInterval = outputSync;
+    bool resuming = !pending.empty();
+    if (resuming) resumeState();     // Continue the RNG streams of the saved chain
 
     // Clear previous measurement data from all registered observables
+    // (a resumed chain keeps the records up to its checkpoint)
+    std::string parameters = "lambda=" + std::to_string(lambda) +
+                             " targetVolume=" + std::to_string(targetVolume) +
+                             " slices=" + std::to_string(universe.nSlices) +
+                             " seed=" + std::to_string(seed) +
+                             " chain=" + std::to_string(chain);
     for (auto o : observables) {
-        o->clear();
+        o->binary = binaryOutput;
+        o->parameters = parameters;  // Header of binary files
+        if (resuming) o->resume();
+        else o->clear();
     }
 
-    seed = seed_;                    // Set RNG seed
-    rng.seed(seed + 0);              // Seed Simulation's RNG with base_seed + 0
-    Universe::seedRNG(seed, 1);      // Seed Universe's RNG with base_seed + 1
-
     // If no geometry was imported, initialize and prepare it
-    if (!Universe::imported) {
-        std::cout << "Starting simulation with target volume: " << targetVolume << std::endl;
+    if (!universe.imported) {
+        Log::print<Log::INFO>("Starting simulation with target volume: ", targetVolume);
         grow();                      // Grow triangulation to targetVolume
         thermalize();                // Thermalize to remove initial bias
-        Simulation::prepare();       // Update geometry data before exporting
-        // Export initial geometry to geom/ directory
-        Universe::exportGeometry(Universe::getGeometryFilename(targetVolume, Universe::nSlices, seed));
+        // Export initial geometry to geom/ directory, written while the first sweeps run
+        checkpoint();
+    } else if (warm) {
+        // Equilibrated at another point: reach targetVolume and relax at this point's lambda
+        printf("warm start from lambda %f, targetVolume %d\n", thermalLambda, thermalVolume);
+        grow();
+        thermalize(warmSweeps);
+        checkpoint();
     }
 
+    // Measurements overlap with the following sweeps on their own workers
+    if (measureThreads > 0) measurePool.reset(new ThreadPool(measureThreads));
+
     // Run measurement phase: perform specified number of sweeps
-    for (int i = 0; i < measurements; i++) {
+    for (int i = measured; i < measurements; i++) {
         sweep();                     // Execute one sweep (batch of moves)
+        measured = i + 1;
         printf("m %d\n", i);         // Print measurement progress
-        // Export geometry every 10 measurements for checkpointing
-        if (i % 10 == 0) Universe::exportGeometry(Universe::getGeometryFilename(targetVolume, Universe::nSlices, seed));
+        // Checkpoint geometry every 10 measurements, written in the background
+        if (i % 10 == 0) checkpoint();
         fflush(stdout);              // Flush output buffer for real-time logging
     }
-    std::cout << "Simulation completed with " << measurements << " measurements." << std::endl;
+    measurePool.reset();             // Waits for the last measurements
+    output.flush();                  // and until their records are written
+    checkpoints.wait();              // Last checkpoint on disk
+    if (std::any_of(observables.begin(), observables.end(), [](Observable* o) { return o->interval == 0; })) {
+        Log::print<Log::INFO>("Volume profile autocorrelation time: ", monitor.time(), " sweeps, measuring every ",
+                              autoInterval());
+    }
+    if (adjustCounts.sweeps > 0) {
+        Log::print<Log::INFO>("Volume adjustment: ", adjustCounts.attempts / static_cast<double>(adjustCounts.sweeps),
+                              " attempts per sweep on average, at most ", adjustCounts.maxAttempts, ", ",
+                              adjustCounts.accepted, " of ", adjustCounts.attempts, " accepted, ",
+                              adjustCounts.fallbacks, " full-chain moves after stalls");
+    }
+    Log::print<Log::INFO>("Simulation completed with ", measurements, " measurements.");
 }
 
-// Attempts a single Monte Carlo move (add, delete, or flip)
-int Simulation::attemptMove() {
-    std::array<int, 2> cumFreqs = {0, 0}; // Cumulative frequencies for move selection
-    int freqTotal = 0;                    // Total frequency sum
-    int prevCumFreq = 0;                  // Previous cumulative frequency
+// Geometry and chain state of the current measurement
+void Simulation::checkpoint() {
+    if (measurePool) measurePool->wait();  // Observable RNGs and records are final
+    // The writer thread syncs the records counted by the state before the state file replaces the last one
+    checkpoints.save(universe, universe.getGeometryFilename(targetVolume, universe.nSlices, seed),
+                     saveState(), universe.getStateFilename(targetVolume, universe.nSlices, seed), &output);
+}
+
+// Payload read in two parts: restore() takes the triangulation, resumeState() the rest once
+// start() has configured the chain; the Checkpointer adds the header (State::seal())
+std::string Simulation::saveState() const {
+    std::ostringstream payload;
+    State::put(payload, moveFreqs);
+    State::put(payload, measured);
+    State::put(payload, thermalLambda);
+    State::put(payload, thermalVolume);
+    State::put(payload, thermalSweeps);
+    universe.saveState(payload);
+
+    State::put(payload, lambda);
+    State::put(payload, targetVolume);
+    State::put(payload, seed);
+    State::put(payload, chain);
+    State::put(payload, binaryOutput);
+    State::put(payload, Random::state(rng));
+    State::put(payload, universe.rngState());
+    State::put(payload, static_cast<std::uint64_t>(observables.size()));
+    for (auto o : observables) o->saveState(payload);
+    State::put(payload, lastMeasured);
+    State::put(payload, monitor.values());
+    return payload.str();
+}
+
+// Checks the header and checksum
+std::string Simulation::readState(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    assert(file.is_open());  // Ensure file opened successfully
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::istringstream in(data);
+    char magic[sizeof(State::magic)] = {};
+    in.read(magic, sizeof(magic));
+    if (!in || memcmp(magic, State::magic, sizeof(magic)) != 0) stateError(filename, "not a chain state file");
+    std::uint32_t version = 0;
+    State::get(in, version);
+    if (version != State::version) stateError(filename, "unsupported version " + std::to_string(version));
+    std::string engine;
+    State::get(in, engine);
+    if (engine != RngName) stateError(filename, "written with the " + engine + " RNG engine");
+    std::uint64_t checksum = 0;
+    State::get(in, checksum);
+    if (!in) stateError(filename, "truncated header");
+
+    std::string payload = data.substr(in.tellg());
+    if (GeometryFile::checksum(payload.data(), payload.size()) != checksum) {
+        stateError(filename, "checksum mismatch");
+    }
+    return payload;
+}
+
+// Loads the triangulation and keeps the rest for start()
+void Simulation::restore(const std::string& filename) {
+    std::string payload = readState(filename);
+    std::istringstream state(payload);
+    State::get(state, moveFreqs);
+    State::get(state, measured);
+    State::get(state, thermalLambda);
+    State::get(state, thermalVolume);
+    State::get(state, thermalSweeps);
+    universe.bind();
+    universe.loadState(state);
+    pending = payload.substr(state.tellg());
+    printf("read %s, %d measurements done\n", filename.c_str(), measured);
+}
+
+// Takes only the triangulation and its thermalization record; this chain keeps its own
+// moveFreqs, RNG streams and output files
+void Simulation::warmStart(const std::string& filename) {
+    universe.bind();
+    if (filename.size() > 6 && filename.compare(filename.size() - 6, 6, ".state") == 0) {
+        std::istringstream state(readState(filename));
+        std::array<int, 2> savedFreqs;
+        int savedMeasured;
+        State::get(state, savedFreqs);
+        State::get(state, savedMeasured);
+        State::get(state, thermalLambda);
+        State::get(state, thermalVolume);
+        State::get(state, thermalSweeps);
+        universe.loadState(state);
+        printf("read %s\n", filename.c_str());
+    } else {
+        universe.importGeometry(filename);
+    }
+    warm = true;
+}
+
+// Applied by start() after configure(), which seeds the RNGs this overwrites
+void Simulation::resumeState() {
+    std::istringstream in(pending);
+    double savedLambda;
+    int savedVolume, savedSeed, savedChain;
+    bool savedBinary;
+    State::get(in, savedLambda);
+    State::get(in, savedVolume);
+    State::get(in, savedSeed);
+    State::get(in, savedChain);
+    State::get(in, savedBinary);
+    if (savedLambda != lambda || savedVolume != targetVolume || savedSeed != seed || savedChain != chain ||
+        savedBinary != binaryOutput) {
+        printf("chain state saved with lambda %f, targetVolume %d, seed %d, chain %d, %s output\n",
+               savedLambda, savedVolume, savedSeed, savedChain, savedBinary ? "binary" : "text");
+        exit(1);
+    }
+
+    std::string state;
+    State::get(in, state);
+    Random::restore(rng, state);
+    State::get(in, state);
+    universe.restoreRNG(state);
+    std::uint64_t count = 0;
+    State::get(in, count);
+    if (count != observables.size()) {
+        printf("chain state saved with %llu observables, %zu registered\n",
+               static_cast<unsigned long long>(count), observables.size());
+        exit(1);
+    }
+    for (auto o : observables) o->loadState(in);
+    State::get(in, lastMeasured);
+    std::vector<double> values;
+    State::get(in, values);
+    monitor.setValues(values);
+    pending.clear();
+}
+
+// Binds the Universe, sets the run parameters and seeds the RNGs
+void Simulation::configure(double lambda_, int targetVolume_, int seed_) {
+    universe.bind();                 // Resolve Labels against this chain's pools
+    targetVolume = targetVolume_;    // Set target number of triangles
+    lambda = lambda_;                // Set cosmological constant
+
+    // Every RNG of the chain gets its own stream of the (seed, chain) key
+    seed = seed_;
+    Random::seed(rng, seed, chain, Random::Simulation);
+    universe.seedRNG(seed, chain, Random::Universe);
+    for (auto i = 0u; i < observables.size(); i++) {
+        observables[i]->seedRNG(seed, chain, Random::Observables + i);
+    }
+
+    // Acceptance factors are constant during the run
+    addWeight = exp(-2 * lambda);
+    deleteWeight = exp(2 * lambda);
+    volumeBoost = exp(2 * epsilon);
+    volumeDamp = 1 / volumeBoost;
 
-    // Compute cumulative frequencies based on moveFreqs
+    // Cumulative frequencies for move selection
+    freqTotal = 0;
     for (auto i = 0u; i < moveFreqs.size(); i++) {
         freqTotal += moveFreqs[i];
-        cumFreqs[i] = prevCumFreq + moveFreqs[i];
-        prevCumFreq = cumFreqs[i];
+        cumFreqs[i] = freqTotal;
     }
+}
 
-    std::uniform_int_distribution<> moveGen(0, freqTotal-1); // Random move selector
-    std::uniform_int_distribution<> binGen(0, 1);            // Binary choice (add vs. delete)
-
-    int move = moveGen(rng);    // Pick a move based on frequency distribution
+// Attempts a single Monte Carlo move (add, delete, or flip)
+// Move frequencies are taken from cumFreqs, precomputed by configure()
+int Simulation::attemptMove() {
+    int move = Random::bounded(rng, freqTotal);  // Pick a move based on frequency distribution
 
     // Execute move based on cumulative frequency ranges
     if (move < cumFreqs[0]) {   // Add or delete move
-        if (binGen(rng) == 0) { // 50% chance for add
+        if (Random::bounded(rng, 2) == 0) { // 50% chance for add
             if (moveAdd()) {
-                // std::cout << "AttemptMove: Add move succeeded." << std::endl; // Uncomment for verbose logging
                 return 1;    // Success: add move executed
             }
         } else {                // 50% chance for delete
             if (moveDelete()) {
-                // std::cout << "AttemptMove: Delete move succeeded." << std::endl; // Uncomment for verbose logging
                 return 2; // Success: delete move executed
             }
         }
     } else if (cumFreqs[0] <= move) {   // Flip move
         if (moveFlip()) {
-            // std::cout << "AttemptMove: Flip move succeeded." << std::endl; // Uncomment for verbose logging
             return 3;       // Success: flip move executed
         }
     }
 
-    // std::cout << "AttemptMove: No move executed." << std::endl; // Uncomment for verbose logging
     return 0;   // No move executed (rejected or invalid)
 }
 
 // Performs one sweep: a batch of move attempts to sample geometry
 void Simulation::sweep() {
-    std::uniform_int_distribution<> uniform_int(0, 3); // Unused in current implementation
-
     std::array<int, 4> moves = {0, 0, 0, 0};    // Track move successes: [0] none, [1] add, [2] delete, [3] flip
-    // Perform 100 * targetVolume move attempts (defines sweep size)
-    for (int i = 0; i < 100 * targetVolume; i++) {
+    // Perform sweepLength() move attempts (100 * targetVolume unless configured)
+    for (int i = 0, n = sweepLength(); i < n; i++) {
         moves[attemptMove()]++;    // Attempt move and increment corresponding counter
     }
-    std::cout << "Sweep completed - Moves: [Rejected: " << moves[0] << ", Add: " << moves[1] 
-              << ", Delete: " << moves[2] << ", Flip: " << moves[3] << "]" << std::endl;
-
-    // Adjust volume to exactly match targetVolume
-    int adjustAttempts = 0;
-    do {
-        attemptMove();
-        adjustAttempts++;
-        if (adjustAttempts % 1000 == 0) {
-            std::cout << "Volume adjustment in progress: " << Universe::trianglesAll.size() 
-                      << " triangles after " << adjustAttempts << " attempts" << std::endl;
-        }
-    } while (Universe::trianglesAll.size() != targetVolume); // Use correct size metric
-    std::cout << "Volume adjusted to " << targetVolume << " triangles in " << adjustAttempts << " attempts" << std::endl;
+    Log::print<Log::INFO>("Sweep completed - Moves: [Rejected: ", moves[0], ", Add: ", moves[1],
+                          ", Delete: ", moves[2], ", Flip: ", moves[3], "]");
+
+    adjustVolume();  // Measure at exactly targetVolume
+
+    // The volume profile's spread decorrelates slowest; record it for autoInterval()
+    double spread = 0;
+    for (auto s : universe.sliceSizes) spread += static_cast<double>(s) * s;
+    monitor.add(spread);
+
+    // Observables due at this sweep (measured counts the sweeps before it)
+    due.clear();
+    int automatic = autoInterval();
+    for (auto i = 0u; i < observables.size(); i++) {
+        int interval = observables[i]->interval > 0 ? observables[i]->interval : automatic;
+        if (lastMeasured[i] >= 0 && measured - lastMeasured[i] < interval) continue;
+        due.push_back(observables[i]);
+        lastMeasured[i] = measured;
+    }
+    if (due.empty()) return;  // Nothing reads the measurement data or the snapshot
 
     prepare();    // Reconstruct geometry connectivity for measurement
-    // Measure all registered observables
-    for (auto o : observables) {
-        o->measure();
+    measure();    // Measure the observables due
+}
+
+int Simulation::autoInterval() const {
+    return std::max(1, static_cast<int>(std::ceil(2 * monitor.time())));
+}
+
+// By default the full chain runs until it hits targetVolume, as it always has: the measured
+// configurations are those of the chain at the moments it passes the target volume.
+// The directed mode (directedAdjust) proposes only the moves towards the target (add below
+// it, delete above it) with the acceptance ratios of moveAdd() and moveDelete(). That proposal
+// is asymmetric and breaks detailed balance, so it samples a biased ensemble; it is opt-in
+// and only meant for runs where the bias has been checked against the full chain.
+// The directed loop stalls where no move towards the target can be accepted (e.g. no order-4
+// vertex outside the minimal slices above it); after adjustPatience rejections in a row, a
+// move of the full chain changes the geometry and the count starts over.
+// Either loop gives up after adjustLimit * targetVolume attempts, rather than spin forever.
+void Simulation::adjustVolume() {
+    const long limit = static_cast<long>(adjustLimit) * targetVolume;
+    int attempts = 0, accepted = 0, rejected = 0;
+    if (!directedAdjust) {
+        // At least one attempt even at the target
+        do {
+            accepted += attemptMove() != 0;
+            attempts++;
+        } while (universe.trianglesAll.size() != targetVolume && attempts < limit);
+    }
+    while (universe.trianglesAll.size() != targetVolume && attempts < limit) {
+        attempts++;
+        bool below = universe.trianglesAll.size() < targetVolume;
+        if (below ? moveAdd() : moveDelete()) {
+            accepted++;
+            rejected = 0;
+        } else if (++rejected >= adjustPatience && attempts < limit) {
+            accepted += attemptMove() != 0;
+            attempts++;
+            adjustCounts.fallbacks++;
+            rejected = 0;
+        }
     }
+    if (universe.trianglesAll.size() != targetVolume) {
+        printf("volume adjustment: %d triangles instead of %d after %d attempts, %d accepted\n",
+               universe.trianglesAll.size(), targetVolume, attempts, accepted);
+        exit(1);
+    }
+
+    adjustCounts.sweeps++;
+    adjustCounts.attempts += attempts;
+    adjustCounts.accepted += accepted;
+    adjustCounts.maxAttempts = std::max(adjustCounts.maxAttempts, attempts);
+    Log::print<Log::DEBUG>("Volume adjusted to ", targetVolume, " triangles in ", attempts, " attempts, ",
+                           accepted, " accepted");
 }
 
-// Attempts an "add" move ((2,4)-move): adds two triangles
-bool Simulation::moveAdd() {
-    double n0 = Vertex::size();         // Current number of vertices
-    double n0_four = Universe::verticesFour.size(); // Number of vertices of order four
+// Measures the observables on a fresh snapshot of the geometry
+void Simulation::measure() {
+    if (measurePool) measurePool->wait();  // Earlier measurements may still read the snapshot
+    snapshot.capture(universe);
 
-    // Acceptance ratio using bookkeeping method (Sec. 2.2.1, Eq. 19)
-    double ar = n0 / (n0_four + 1.0) * exp(-2 * lambda);
-    if (targetVolume > 0) {     // Apply volume-fixing term if target is set
-        double expesp = exp(2 * epsilon);
-        // Boost/reduce acceptance based on current vs. target volume
-        ar *= Universe::trianglesAll.size() < targetVolume ? expesp : 1 / expesp; // Use correct size
+    if (!measurePool) {
+        for (auto o : due) {
+            o->measure();
+        }
+        return;
     }
+    // Every observable has its own RNG and BFS state, so each can run as a separate task
+    for (auto o : due) {
+        measurePool->submit([o] { o->measure(); });
+    }
+}
 
-    Triangle::Label t = Universe::trianglesAll.pick(); // Randomly select a triangle
-    if (Universe::trianglesAll.size() == 0) {
-        std::cout << "moveAdd: Error - trianglesAll bag is empty!" << std::endl;
+// Attempts an "add" move ((2,4)-move): adds two triangles
+// Checks that the move is possible before computing its acceptance ratio
+bool Simulation::moveAdd() {
+    if (universe.trianglesAll.size() == 0) {
+        Log::print<Log::ERROR>("moveAdd: Error - trianglesAll bag is empty!");
         return false;
     }
+    Triangle::Label t = universe.trianglesAll.pick(); // Randomly select a triangle
 
     // Reject move if spherical topology and triangle is at time 0 (boundary condition)
-    if (Universe::sphere) {
+    if (universe.sphere) {
         if (t->time == 0) {
-            std::cout << "moveAdd: Rejected - triangle at time 0 (boundary condition)" << std::endl;
+            Log::print<Log::TRACE>("moveAdd: Rejected - triangle at time 0 (boundary condition)");
+            MoveTrace::record(1, false, t, universe.trianglesAll.size());
             return false;
         }
     }
 
-    // Metropolis acceptance: compare random number to acceptance ratio
+    double n0 = Vertex::size();         // Current number of vertices
+    double n0_four = universe.verticesFour.size(); // Number of vertices of order four
+
+    // Acceptance ratio using bookkeeping method (Sec. 2.2.1, Eq. 19)
+    double ar = n0 / (n0_four + 1.0) * addWeight;
+    if (targetVolume > 0) {     // Apply volume-fixing term if target is set
+        // Boost/reduce acceptance based on current vs. target volume
+        ar *= universe.trianglesAll.size() < targetVolume ? volumeBoost : volumeDamp;
+    }
+
+    // Metropolis acceptance: accepted outright when ar >= 1, no random number drawn
     if (ar < 1.0) {
-        std::uniform_real_distribution<> uniform(0.0, 1.0);
-        double r = uniform(rng);
+        double r = Random::uniform(rng);
         if (r > ar) {
-            std::cout << "moveAdd: Rejected - random " << r << " > acceptance ratio " << ar << std::endl;
+            Log::print<Log::TRACE>("moveAdd: Rejected - random ", r, " > acceptance ratio ", ar);
+            MoveTrace::record(1, false, t, universe.trianglesAll.size());
             return false;    // Reject move
         }
     }
 
-    int oldSize = Universe::trianglesAll.size();
-    Universe::insertVertex(t);    // Execute add move: insert vertex, add two triangles
-    std::cout << "moveAdd: Accepted - Added vertex to triangle " << t 
-              << ", triangles increased from " << oldSize << " to " << Universe::trianglesAll.size() << std::endl;
+    int oldSize = universe.trianglesAll.size();
+    universe.insertVertex(t);    // Execute add move: insert vertex, add two triangles
+    Log::print<Log::TRACE>("moveAdd: Accepted - Added vertex to triangle ", t,
+                           ", triangles increased from ", oldSize, " to ", universe.trianglesAll.size());
+    MoveTrace::record(1, true, t, universe.trianglesAll.size());
     return true;                  // Move accepted
 }
 
 // Attempts a "delete" move ((4,2)-move): removes two triangles
 bool Simulation::moveDelete() {
     // Reject if no vertices of order four are available
-    if (Universe::verticesFour.size() == 0) {
-        std::cout << "moveDelete: Rejected - no vertices of order four available" << std::endl;
+    if (universe.verticesFour.size() == 0) {
+        Log::print<Log::TRACE>("moveDelete: Rejected - no vertices of order four available");
+        MoveTrace::record(2, false, -1, universe.trianglesAll.size());
         return false;
     }
 
     double n0 = Vertex::size();         // Current number of vertices
-    double n0_four = Universe::verticesFour.size(); // Number of vertices of order four
+    double n0_four = universe.verticesFour.size(); // Number of vertices of order four
 
     // Acceptance ratio using bookkeeping method (Sec. 2.2.1, Eq. 20)
-    double ar = n0_four / (n0 - 1.0) * exp(2 * lambda);
+    double ar = n0_four / (n0 - 1.0) * deleteWeight;
     if (targetVolume > 0) {     // Apply volume-fixing term
-        double expesp = exp(2 * epsilon);
         // Boost/reduce acceptance based on current vs. target volume
-        ar *= Universe::trianglesAll.size() < targetVolume ? 1 / expesp : expesp; // Use correct size
+        ar *= universe.trianglesAll.size() < targetVolume ? volumeDamp : volumeBoost;
     }
 
-    // Metropolis acceptance check
+    // Metropolis acceptance check, before the pick: the vertex it would touch is likely not in cache
     if (ar < 1.0) {
-        std::uniform_real_distribution<> uniform(0.0, 1.0);
-        double r = uniform(rng);
+        double r = Random::uniform(rng);
         if (r > ar) {
-            std::cout << "moveDelete: Rejected - random " << r << " > acceptance ratio " << ar << std::endl;
+            Log::print<Log::TRACE>("moveDelete: Rejected - random ", r, " > acceptance ratio ", ar);
+            MoveTrace::record(2, false, -1, universe.trianglesAll.size());
             return false;    // Reject move
         }
     }
 
-    Vertex::Label v = Universe::verticesFour.pick(); // Pick a vertex of order four
+    Vertex::Label v = universe.verticesFour.pick(); // Pick a vertex of order four
     // Reject if slice size would drop below 4 (maintains manifold condition)
-    if (Universe::sliceSizes[v->time] < 4) {
-        std::cout << "moveDelete: Rejected - slice size at time " << v->time << " would drop below 4" << std::endl;
+    if (universe.sliceSizes[v->time] < 4) {
+        Log::print<Log::TRACE>("moveDelete: Rejected - slice size at time ", v->time, " would drop below 4");
+        MoveTrace::record(2, false, v, universe.trianglesAll.size());
         return false;
     }
 
-    int oldSize = Universe::trianglesAll.size();
-    Universe::removeVertex(v);    // Execute delete move: remove vertex and two triangles
-    std::cout << "moveDelete: Accepted - Removed vertex " << v 
-              << ", triangles decreased from " << oldSize << " to " << Universe::trianglesAll.size() << std::endl;
+    int oldSize = universe.trianglesAll.size();
+    universe.removeVertex(v);    // Execute delete move: remove vertex and two triangles
+    Log::print<Log::TRACE>("moveDelete: Accepted - Removed vertex ", v,
+                           ", triangles decreased from ", oldSize, " to ", universe.trianglesAll.size());
+    MoveTrace::record(2, true, v, universe.trianglesAll.size());
     return true;                  // Move accepted
 }
 
 // Attempts a "flip" move ((2,2)-move): flips a timelike edge
 bool Simulation::moveFlip() {
     // Reject if no flippable triangles exist
-    if (Universe::trianglesFlip.size() == 0) {
-        std::cout << "moveFlip: Rejected - no flippable triangles available" << std::endl;
+    if (universe.trianglesFlip.size() == 0) {
+        Log::print<Log::TRACE>("moveFlip: Rejected - no flippable triangles available");
+        MoveTrace::record(3, false, -1, universe.trianglesAll.size());
         return false;
     }
 
-    auto t = Universe::trianglesFlip.pick();    // Pick a flippable triangle
+    auto t = universe.trianglesFlip.pick();    // Pick a flippable triangle
 
-    int wa = Universe::trianglesFlip.size();    // Number of flippable triangles before move
+    int wa = universe.trianglesFlip.size();    // Number of flippable triangles before move
     int wb = wa;                                // Number after move (adjusted below)
     // Adjust wb based on type changes of neighboring triangles (Sec. 2.2.2)
     if (t->type == t->getTriangleLeft()->type) {
@@ -236,82 +493,74 @@ bool Simulation::moveFlip() {
 
     // Metropolis acceptance check
     if (ar < 1.0) {
-        std::uniform_real_distribution<> uniform(0.0, 1.0);
-        double r = uniform(rng);
+        double r = Random::uniform(rng);
         if (r > ar) {
-            std::cout << "moveFlip: Rejected - random " << r << " > acceptance ratio " << ar << std::endl;
+            Log::print<Log::TRACE>("moveFlip: Rejected - random ", r, " > acceptance ratio ", ar);
+            MoveTrace::record(3, false, t, universe.trianglesAll.size());
             return false;    // Reject move
         }
     }
 
-    Universe::flipLink(t);    // Execute flip move: swap timelike edge
-    std::cout << "moveFlip: Accepted - Flipped link for triangle " << t << std::endl;
+    universe.flipLink(t);    // Execute flip move: swap timelike edge
+    Log::print<Log::TRACE>("moveFlip: Accepted - Flipped link for triangle ", t);
+    MoveTrace::record(3, true, t, universe.trianglesAll.size());
     return true;              // Move accepted
 }
 
 // Prepares geometry for measurement by updating connectivity data
 void Simulation::prepare() {
-    std::cout << "Preparing geometry data..." << std::endl;
-    Universe::updateVertexData();    // Refresh vertex neighbor lists
-    Universe::updateTriangleData();  // Refresh triangle neighbor lists
-    Universe::updateLinkData();      // Refresh link data (edges)
-    std::cout << "Geometry data updated." << std::endl;
+    Log::print<Log::DEBUG>("Preparing geometry data...");
+    universe.updateData();    // Refresh vertex/triangle neighbor lists and link data
+    Log::print<Log::DEBUG>("Geometry data updated.");
 }
 
 // Grows the triangulation to reach targetVolume
 void Simulation::grow() {
     int growSteps = 0;
     printf("growing");
-    std::cout << "Growth phase started. Initial triangles: " << Universe::trianglesAll.size() << std::endl;
+    Log::print<Log::INFO>("Growth phase started. Initial triangles: ", universe.trianglesAll.size());
     do {
-        // Perform 10 * targetVolume move attempts per step for faster growth
-        for (int i = 0; i < 10 * targetVolume; i++) attemptMove();
+        // Perform 10 * targetVolume move attempts per step (unless configured) for faster growth
+        for (int i = 0, n = growAttempts > 0 ? growAttempts : 10 * targetVolume; i < n; i++) attemptMove();
         printf(".");
         fflush(stdout);
         growSteps++;
-        std::cout << "Grow sweep " << growSteps << ": " << Universe::trianglesAll.size() << " triangles" << std::endl;
-    } while (Universe::trianglesAll.size() < targetVolume); // Use correct size metric
+        Log::print<Log::DEBUG>("Grow sweep ", growSteps, ": ", universe.trianglesAll.size(), " triangles");
+    } while (universe.trianglesAll.size() < targetVolume); // Use correct size metric
     printf("\n");
     printf("grown in %d sweeps\n", growSteps);
-    std::cout << "Growth phase completed with " << Universe::trianglesAll.size() << " triangles in " 
-              << growSteps << " sweeps" << std::endl;
+    Log::print<Log::INFO>("Growth phase completed with ", universe.trianglesAll.size(), " triangles in ",
+                          growSteps, " sweeps");
 }
 
 // Thermalizes the system to remove initial geometry bias
-void Simulation::thermalize() {
+void Simulation::thermalize(int minSweeps) {
     int thermSteps = 0;
     printf("thermalizing");
-    std::cout << "Thermalization phase started." << std::endl;
+    Log::print<Log::INFO>("Thermalization phase started.");
     fflush(stdout);
     // Coordination number bound to ensure equilibrium (logarithmic scaling)
     double coordBound = log(2 * targetVolume) / static_cast<double>(log(2));
     int maxUp, maxDown;    // Maximum upward/downward coordination numbers
+    universe.trackCoordination(true);  // Counted once here, then kept by the moves
     do {
-        // Perform 100 * targetVolume move attempts per step
-        for (int i = 0; i < 100 * targetVolume; i++) attemptMove();
+        // Perform one sweep of move attempts per step
+        for (int i = 0, n = sweepLength(); i < n; i++) attemptMove();
         printf(".");
         fflush(stdout);
 
-        prepare();    // Update connectivity data
-        maxUp = 0;
-        maxDown = 0;
-        // Check coordination numbers for all vertices
-        for (auto v : Universe::vertices) {
-            int nup = 0, ndown = 0;
-            for (auto vn : Universe::vertexNeighbors.at(v)) {
-                // Count upward connections (including periodic boundary)
-                if (vn->time > v->time || (v->time == Universe::nSlices-1 && vn->time == 0)) nup++;
-                // Count downward connections
-                if (vn->time < v->time || (v->time == 0 && vn->time == Universe::nSlices-1)) ndown++;
-            }
-            if (nup > maxUp) maxUp = nup;
-            if (ndown > maxDown) maxDown = ndown;
-        }
+        // Largest coordination numbers, kept up to date by the moves
+        maxUp = universe.coordUp.max();
+        maxDown = universe.coordDown.max();
         thermSteps++;
-        std::cout << "Thermalization sweep " << thermSteps << ": maxUp = " << maxUp 
-                  << ", maxDown = " << maxDown << ", coordBound = " << coordBound << std::endl;
-    } while (maxUp > coordBound || maxDown > coordBound);    // Continue until coordination stabilizes
+        Log::print<Log::DEBUG>("Thermalization sweep ", thermSteps, ": maxUp = ", maxUp,
+                               ", maxDown = ", maxDown, ", coordBound = ", coordBound);
+    } while (thermSteps < minSweeps || maxUp > coordBound || maxDown > coordBound);  // Until coordination stabilizes
     printf("\n");
     printf("thermalized in %d sweeps\n", thermSteps);
-    std::cout << "Thermalization completed in " << thermSteps << " sweeps" << std::endl;
+    universe.trackCoordination(false);
+    thermalLambda = lambda;          // Recorded in the chain state of later checkpoints
+    thermalVolume = targetVolume;
+    thermalSweeps = thermSteps;
+    Log::print<Log::INFO>("Thermalization completed in ", thermSteps, " sweeps");
 }
\ No newline at end of file
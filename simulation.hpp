@@ -1,90 +1,272 @@
 // Copyright 2020 Joren Brunekreef and Andrzej Görlich
 #pragma once    // Ensures this header is included only once during compilation
 
-#include <random>       // Provides random number generation (e.g., std::default_random_engine)
+#include "rng.hpp"      // Random number engine and bounded draws
 #include <vector>       // Used for storing pointers to Observable objects
 #include "universe.hpp" // Defines Universe class, representing the CDT geometry
 #include "observable.hpp" // Base class for observables measured during simulation
+#include "snapshot.hpp" // Read-only geometry copy the observables measure
+#include "thread_pool.hpp" // Workers for concurrent measurements
+#include "writer.hpp"   // Background writer of the observables' files
+#include "checkpoint.hpp" // Background writer of geometry checkpoints
+#include "autocorrelation.hpp" // Measurement cadence of interval-0 observables
+#include <memory>       // Owning pointer to the measurement pool
 
+/****
+ * A Simulation runs one Markov chain on a Universe it does not own.
+ * All sampler state (RNG, parameters, observables) is per instance, so
+ * independent chains can run concurrently, one per thread, as long as each
+ * has its own Universe.
+ *
+ * Observables measure a GeometrySnapshot taken after each sweep. With
+ * measureThreads > 0 they run as tasks on a pool of that many workers,
+ * while the next sweep already moves the live geometry; the snapshot is
+ * only retaken once the previous measurements have finished.
+ *
+ * Each observable is measured every Observable::interval sweeps; sweeps
+ * where none is due skip the data update and the snapshot altogether.
+ * Observables with interval 0 follow the integrated autocorrelation time
+ * of the volume profile (the sum of squared slice sizes, recorded after
+ * every sweep) and are measured once 2 * tau sweeps have passed.
+ *
+ * Every geometry checkpoint comes with a chain state file: the raw pools
+ * and bags of the Universe, all RNG states, the measurement counter and
+ * how far each observable's file had got. restore() reads it back, and
+ * start() then continues the chain exactly where the checkpoint was taken,
+ * with the same draws and the same records as an uninterrupted run.
+ * The state also records the point (lambda, targetVolume) the triangulation
+ * was thermalized at. warmStart() uses it to seed a chain at a new point
+ * from another point's checkpoint, which then only needs to relax instead
+ * of growing and thermalizing from scratch.
+ ****/
 class Simulation {
 public:
-    // Static cosmological constant, set by main() from config file (typically ln(2) for 2D CDT)
-    static double lambda;
-    
-    // Static seed for random number generator, set by main() for reproducibility
-    static int seed;
+    // Creates a simulation that samples the given Universe
+    explicit Simulation(Universe& universe) : universe(universe) {}
+
+    // Cosmological constant, set by start() (typically ln(2) for 2D CDT)
+    double lambda = 0;
+
+    // Seed for random number generator, set by start() for reproducibility
+    int seed = 0;
+
+    // Chain id, part of the RNG key next to seed
+    // Chains sharing a seed but differing in chain id draw independent streams
+    int chain = 0;
 
     // Initiates the Monte Carlo simulation with specified parameters
+    // Binds the Universe to the calling thread, so start() may run on any thread
     // sweeps: number of measurement sweeps to perform
     // lambda_: cosmological constant for action computation
     // targetVolume_: desired number of triangles
     // seed_: RNG seed (defaults to 0 if not provided)
-    static void start(int sweeps, double lambda_, int targetVolume_, int seed_ = 0);
+    // After restore(), skips growth and thermalization and continues from the saved
+    // measurement; the parameters must match those of the saved chain
+    void start(int sweeps, double lambda_, int targetVolume_, int seed_ = 0);
+
+    // Loads a chain state file written at a checkpoint (Universe::getStateFilename())
+    // Fills the empty Universe and moveFreqs; the RNGs and observables are restored by start()
+    // Exits with a message if the file is damaged or was written by another RNG engine
+    void restore(const std::string& filename);
+
+    // Loads the triangulation of another chain's checkpoint to start this one from
+    // filename: a chain state file, or a geometry file (without thermalization record)
+    // start() then adjusts the volume and thermalizes for at least warmSweeps sweeps
+    void warmStart(const std::string& filename);
+
+    // Minimum thermalization sweeps of a chain seeded by warmStart(), read by start()
+    int warmSweeps = 10;
+
+    // Binds the Universe to the calling thread, sets the parameters and seeds the RNGs
+    // Called by start(); also lets tools (e.g. bench/) drive attemptMove() directly
+    void configure(double lambda_, int targetVolume_, int seed_);
 
     // Adds an observable to the simulation for measurement
     // o: reference to an Observable object (e.g., VolumeProfile, Hausdorff)
-    // Stores pointer in observables vector
-    static void addObservable(Observable& o) {
+    // Stores pointer in observables vector and attaches it to this simulation's snapshot and writer
+    void addObservable(Observable& o) {
+        o.attach(snapshot, output);
         observables.push_back(&o);
+        lastMeasured.push_back(-1);
     }
 
+    // Move attempts per sweep, 0 (default) for 100 * targetVolume; read by start()
+    // Thermalization checks its bound after every sweep of this length
+    int sweepAttempts = 0;
+
+    // Move attempts per growth step, 0 (default) for 10 * targetVolume; read by start()
+    int growAttempts = 0;
+
+    // Sweeps between measurements of interval-0 observables: 2 * tau of the volume profile, at least 1
+    int autoInterval() const;
+
+    // Worker threads measuring observables concurrently with the next sweep
+    // 0 (default) measures them in turn on the simulation's thread; read by start()
+    int measureThreads = 0;
+
+    // Seconds between fsyncs of the observables' files, 0 (default) leaves it to the OS
+    // Read by start()
+    double outputSync = 0;
+
+    // Write the observables as binary series files (series.hpp) instead of text; read by start()
+    bool binaryOutput = false;
+
     // Flag indicating if topology pinching is allowed (not used in current 2D setup)
-    static bool pinch;
+    bool pinch = false;
 
     // Tracks frequency of move attempts: [0] for add/delete, [1] for flip
-    // Used to monitor simulation dynamics
-    static std::array<int, 2> moveFreqs;
+    // Used to monitor simulation dynamics; read by configure(), so set it before start()
+    std::array<int, 2> moveFreqs = {1, 1};
 
     // Attempts a single Monte Carlo move (add, delete, or flip)
     // Returns number of successful moves (typically 0 or 1)
-    static int attemptMove();
+    int attemptMove();
+
+    // Attempt counts of the volume adjustment that ends every sweep (adjustVolume()),
+    // summed over the run and logged at its end
+    struct AdjustCounts {
+        long sweeps = 0;        // Sweeps adjusted
+        long attempts = 0;      // Move attempts, full-chain fallbacks included
+        long accepted = 0;      // Accepted ones among them
+        long fallbacks = 0;     // Full-chain moves made because the directed ones stalled (directedAdjust)
+        int maxAttempts = 0;    // Most attempts a single sweep needed
+    };
+    AdjustCounts adjustCounts;
+
+    // false (default): adjustVolume() runs the full chain until it hits targetVolume
+    // true: it proposes only moves towards targetVolume, which breaks detailed balance (biased)
+    bool directedAdjust = false;
 
 private:
+    // The triangulation sampled by this chain
+    Universe& universe;
+
     // Random number generator for Monte Carlo moves, seeded by seed
-    static std::default_random_engine rng;
+    Rng rng{0};
 
     // Target number of triangles, set by start() to guide volume-fixing
-    static int targetVolume;
+    int targetVolume = 0;
 
     // Strength of volume-fixing term (S_fix = epsilon * (N - targetVolume)^2)
     // Controls fluctuations around targetVolume
-    static double epsilon;
+    double epsilon = 0.02;
 
     // Flag indicating if simulation is in measurement phase (vs. thermalization)
-    static bool measuring;
+    bool measuring = false;
+
+    // Per-run constants of the acceptance ratios, set by configure()
+    // lambda and epsilon are fixed for a run, so exp() is evaluated once per run instead of per attempt
+    double addWeight = 1;       // exp(-2 * lambda), bulk factor of the add move
+    double deleteWeight = 1;    // exp(2 * lambda), bulk factor of the delete move
+    double volumeBoost = 1;     // exp(2 * epsilon), volume-fixing factor towards targetVolume
+    double volumeDamp = 1;      // 1 / volumeBoost, volume-fixing factor away from targetVolume
+
+    // Cumulative move frequencies derived from moveFreqs by configure()
+    std::array<int, 2> cumFreqs = {1, 2};
+    int freqTotal = 2;
+
+    // Measurements completed, saved in the chain state
+    int measured = 0;
+
+    // Point the triangulation was thermalized at and the sweeps it took, saved in the chain state
+    // thermalVolume is 0 for an imported geometry of unknown origin
+    double thermalLambda = 0;
+    int thermalVolume = 0;
+    int thermalSweeps = 0;
+
+    // Set by warmStart(): the triangulation comes from another point and needs to relax
+    bool warm = false;
+
+    // Part of a restored chain state that start() applies after configure():
+    // run parameters, RNG states and observable states
+    std::string pending;
 
     // Vector of pointers to observables registered for measurement
     // Populated by addObservable()
-    static std::vector<Observable*> observables;
+    std::vector<Observable*> observables;
+
+    // Sweep of each observable's last measurement, -1 before the first; saved in the chain state
+    std::vector<int> lastMeasured;
+
+    // Observables measured after the current sweep, chosen by sweep()
+    std::vector<Observable*> due;
+
+    // Sum of squared slice sizes after every sweep, for autoInterval(); saved in the chain state
+    Autocorrelation monitor;
+
+    // Geometry measured by the observables, retaken by measure() after every sweep with one due
+    GeometrySnapshot snapshot;
+
+    // Buffers and writes the observables' records (declared before measurePool,
+    // so measurements still running at destruction have somewhere to write)
+    OutputWriter output;
+
+    // Writes the geometry checkpoints of start() while sampling continues
+    Checkpointer checkpoints;
+
+    // Runs the observables when measureThreads > 0, created by start()
+    std::unique_ptr<ThreadPool> measurePool;
 
-    // Performs one sweep: a batch of move attempts (size depends on targetVolume)
+    // Serializes the complete chain state for restore()
+    // No measurement may be running
+    std::string saveState() const;
+
+    // Reads a chain state file and checks its header and checksum; returns the payload
+    std::string readState(const std::string& filename);
+
+    // Checks the parameters stored in pending and restores the RNGs and observables from it
+    void resumeState();
+
+    // Queues a geometry checkpoint and the chain state, once the measurements so far are written
+    void checkpoint();
+
+    // Captures the snapshot and measures the observables in due on it
+    // With a pool, waits for the previous measurements first and returns once the new ones are queued
+    void measure();
+
+    // Move attempts of a sweep (sweepAttempts or its default)
+    int sweepLength() const { return sweepAttempts > 0 ? sweepAttempts : 100 * targetVolume; }
+
+    // Performs one sweep: a batch of sweepLength() move attempts, then measures the observables due
     // Core of Monte Carlo sampling
-    static void sweep();
+    void sweep();
+
+    // Brings the volume to exactly targetVolume at the end of a sweep by running the full chain,
+    // or with directedAdjust by add moves below and delete moves above the target only;
+    // counts the attempts in adjustCounts and exits if adjustLimit is reached
+    void adjustVolume();
+
+    // Directed attempts rejected in a row before adjustVolume() makes a full-chain move
+    static constexpr int adjustPatience = 100;
+
+    // Attempts per triangle of targetVolume after which adjustVolume() gives up (a default sweep)
+    static constexpr int adjustLimit = 100;
 
     // Attempts an "add" move ((2,4)-move): adds two triangles
     // Returns true if accepted, false if rejected (per Metropolis algorithm)
-    static bool moveAdd();
+    bool moveAdd();
 
     // Attempts a "delete" move ((4,2)-move): removes two triangles
     // Returns true if accepted, false if rejected
-    static bool moveDelete();
+    bool moveDelete();
 
     // Attempts a "flip" move ((2,2)-move): flips a timelike edge
     // Returns true if accepted, false if rejected
-    static bool moveFlip();
+    bool moveFlip();
 
     // Prepares geometry for measurement by reconstructing connectivity
     // Called before observable computation (e.g., neighbor lists for BFS)
-    static void prepare();
+    void prepare();
 
     // Tuning function to adjust lambda to pseudocritical value
     // Commented out as unused in 2D CDT (lambda fixed at ln(2))
     // static void tune();
 
     // Grows the triangulation to targetVolume during initialization
-    static void grow();
+    void grow();
 
     // Thermalizes the system: runs sweeps to reach equilibrium
     // Ensures initial geometry bias is removed before measurements
-    static void thermalize();
+    // minSweeps: sweeps to run even if the coordination bound is met earlier
+    void thermalize(int minSweeps = 0);
 };
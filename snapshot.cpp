@@ -0,0 +1,187 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include <cassert>          // File checks
+#include <fstream>          // Geometry file output
+#include <cstdio>           // Error messages, rename()
+#include <cstdlib>          // exit() on failed writes
+#include <cstring>          // memcpy of the magic
+#include <cerrno>           // Retrying interrupted writes
+#include <fcntl.h>          // open()
+#include <sys/uio.h>        // writev()
+#include <unistd.h>         // close(), fsync()
+#include "snapshot.hpp"     // GeometrySnapshot interface
+
+// Copies the lists and graphs, and resolves the vertex times through the bound pools
+void GeometrySnapshot::capture(const Universe& universe) {
+    nSlices = universe.nSlices;
+    sliceSizes = universe.sliceSizes;
+    vertices = universe.vertices;
+    triangles = universe.triangles;
+    vertexGraph = universe.vertexGraph;
+    triangleGraph = universe.triangleGraph;
+
+    vertexTimes.resize(vertices.size());
+    for (auto i = 0u; i < vertices.size(); i++) {
+        vertexTimes[i] = vertices[i]->time;
+    }
+}
+
+// Numbers the simplices densely, then copies times and connectivity through the bound pools
+void TriangulationSnapshot::capture(const Universe& universe) {
+    nSlices = universe.nSlices;
+    vertexIds.resize(Vertex::pool_capacity());
+    triangleIds.resize(Triangle::pool_capacity());
+
+    // Every vertex is the left vertex of exactly one upward triangle
+    vertexTimes.clear();
+    int nT = 0;
+    for (auto t : universe.trianglesAll) {
+        triangleIds[t] = nT++;
+        if (t->isUpwards()) {
+            auto v = t->getVertexLeft();
+            vertexIds[v] = static_cast<int>(vertexTimes.size());
+            vertexTimes.push_back(v->time);
+        }
+    }
+
+    triangleVertices.resize(3 * nT);
+    triangleNeighbors.resize(3 * nT);
+    int i = 0;
+    for (auto t : universe.trianglesAll) {
+        triangleVertices[i] = vertexIds[t->getVertexLeft()];
+        triangleVertices[i + 1] = vertexIds[t->getVertexRight()];
+        triangleVertices[i + 2] = vertexIds[t->getVertexCenter()];
+        triangleNeighbors[i] = triangleIds[t->getTriangleLeft()];
+        triangleNeighbors[i + 1] = triangleIds[t->getTriangleRight()];
+        triangleNeighbors[i + 2] = triangleIds[t->getTriangleCenter()];
+        i += 3;
+    }
+}
+
+// Writes vertex count, times, counts, then per triangle its 3 vertices and 3 neighbors
+// The vertex and triangle counts are repeated as in the original format
+void TriangulationSnapshot::write(const std::string& geometryFilename) const {
+    std::string output;
+    output += std::to_string(nVertices()) + "\n";
+    for (auto time : vertexTimes) {
+        output += std::to_string(time) + "\n";
+    }
+
+    output += std::to_string(nVertices()) + "\n";
+    output += std::to_string(nTriangles()) + "\n";
+    for (int j = 0; j < nTriangles(); j++) {
+        for (int k = 0; k < 3; k++) {
+            output += std::to_string(triangleVertices[3 * j + k]) + "\n";
+        }
+        for (int k = 0; k < 3; k++) {
+            output += std::to_string(triangleNeighbors[3 * j + k]) + "\n";
+        }
+    }
+    output += std::to_string(nTriangles());
+
+    std::ofstream file;
+    file.open(geometryFilename, std::ios::out | std::ios::trunc);  // Overwrite mode
+    assert(file.is_open());
+    file << output << "\n";
+    file.close();
+    if (file.fail()) {  // Out of space or I/O error: exit before save() renames a partial file
+        printf("%s: writing the geometry failed\n", geometryFilename.c_str());
+        exit(1);
+    }
+}
+
+// Header and the three arrays go out in one writev(), without copying them into a buffer
+void TriangulationSnapshot::writeBinary(const std::string& geometryFilename) const {
+    assert(GeometryFile::littleEndian());
+
+    GeometryFile::Header header;
+    std::memcpy(header.magic, GeometryFile::magic, sizeof(header.magic));
+    header.version = GeometryFile::version;
+    header.nSlices = nSlices;
+    header.nVertices = vertexTimes.size();
+    header.nTriangles = nTriangles();
+
+    struct iovec parts[4] = {
+        {&header, sizeof(header)},
+        {const_cast<int*>(vertexTimes.data()), vertexTimes.size() * sizeof(int)},
+        {const_cast<int*>(triangleVertices.data()), triangleVertices.size() * sizeof(int)},
+        {const_cast<int*>(triangleNeighbors.data()), triangleNeighbors.size() * sizeof(int)},
+    };
+    header.checksum = GeometryFile::checksumSeed;
+    for (int i = 1; i < 4; i++) header.checksum = GeometryFile::checksum(parts[i].iov_base, parts[i].iov_len, header.checksum);
+
+    int fd = open(geometryFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(fd >= 0);
+    struct iovec* part = parts;
+    int left = 4;
+    while (left > 0) {
+        ssize_t n = writev(fd, part, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            perror(geometryFilename.c_str());
+            exit(1);
+        }
+        // Skip what was written; a short write leaves the rest of a part for the next call
+        while (left > 0 && static_cast<std::size_t>(n) >= part->iov_len) {
+            n -= part->iov_len;
+            part++;
+            left--;
+        }
+        if (left > 0) {
+            part->iov_base = static_cast<char*>(part->iov_base) + n;
+            part->iov_len -= n;
+        }
+    }
+    if (close(fd) != 0) {  // Deferred write errors surface here
+        perror(geometryFilename.c_str());
+        exit(1);
+    }
+}
+
+// Write to temp, fsync, atomic rename
+// Any write or sync error exits before the rename, so the previous checkpoint stays intact
+void TriangulationSnapshot::save(const std::string& geometryFilename, bool binary) const {
+    std::string temporary = geometryFilename + ".tmp";
+    if (binary) writeBinary(temporary);
+    else write(temporary);
+
+    int fd = open(temporary.c_str(), O_RDONLY);
+    assert(fd >= 0);
+    // Data on disk before the rename makes it visible
+    int synced;
+    while ((synced = fsync(fd)) != 0 && errno == EINTR) {}
+    if (synced != 0 || close(fd) != 0) {
+        perror(temporary.c_str());
+        exit(1);
+    }
+    if (rename(temporary.c_str(), geometryFilename.c_str()) != 0) {
+        perror(geometryFilename.c_str());
+        exit(1);
+    }
+}
+
+namespace GeometryFile {
+
+const char magic[8] = {'C', 'D', 'T', 'G', 'E', 'O', 'M', '\n'};
+
+std::uint64_t checksum(const void* data, std::size_t size, std::uint64_t hash) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;  // FNV prime
+    }
+    return hash;
+}
+
+bool isBinary(const std::string& geometryFilename) {
+    char start[sizeof(magic)] = {};
+    std::ifstream file(geometryFilename, std::ios::binary);
+    file.read(start, sizeof(start));
+    return file && std::memcmp(start, magic, sizeof(magic)) == 0;
+}
+
+bool littleEndian() {
+    const std::uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+}  // namespace GeometryFile
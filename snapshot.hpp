@@ -0,0 +1,126 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * GeometrySnapshot is a read-only copy of the measurement data of a
+ * Universe, taken by capture() after Universe::updateData(). Labels are
+ * stored as plain ids and never dereferenced: everything an observable
+ * reads through a Label (such as a vertex's time) is copied into dense
+ * arrays. The snapshot therefore does not depend on the pools bound to a
+ * thread, and observables can measure it on any thread while the Markov
+ * chain keeps moving the live geometry.
+ *
+ * TriangulationSnapshot is a compact, read-only copy of the triangulation
+ * itself: the contents of a geometry file. Vertices and triangles are
+ * relabeled densely, vertex times are stored in one array and the
+ * vertices and neighbors of each triangle in two flat arrays of three
+ * entries per triangle. It is taken straight from the bags, so it needs no
+ * updateData(), and like GeometrySnapshot it can be read on any thread.
+ *
+ * GeometryFile describes the binary geometry format (geometryFormat
+ * binary): a 40-byte Header followed by three little-endian int32 arrays,
+ * the vertex times, the triangle vertices and the triangle neighbors, laid
+ * out exactly as in a TriangulationSnapshot. The header holds the counts
+ * and a 64-bit FNV-1a checksum of the arrays, so a file can be mapped and
+ * read in place.
+ ****/
+
+#include <cstddef>          // Byte counts
+#include <cstdint>          // Fixed-width header fields
+#include <string>           // Geometry file names
+#include <vector>           // Simplex lists and per-node data
+#include "universe.hpp"     // Source of the captured data
+#include "graph.hpp"        // CSR adjacency
+
+class GeometrySnapshot {
+public:
+    // Number of time slices
+    int nSlices = 0;
+
+    // Number of vertices in each time slice
+    std::vector<int> sliceSizes;
+
+    // Simplex lists, in the order of the dense ids of the graphs
+    std::vector<Vertex::Label> vertices;
+    std::vector<Triangle::Label> triangles;
+
+    // Adjacency of the vertices and of the dual lattice
+    Graph vertexGraph;
+    Graph triangleGraph;
+
+    // Time slice of each vertex, by dense id
+    std::vector<int> vertexTimes;
+
+    // Time slice of a vertex of the snapshot
+    int time(Vertex::Label v) const { return vertexTimes[vertexGraph.ids[v]]; }
+
+    // Copies the measurement data of a Universe whose updateData() is current
+    // Runs on the thread the Universe is bound to; buffers are reused between captures
+    void capture(const Universe& universe);
+};
+
+class TriangulationSnapshot {
+public:
+    // Number of time slices
+    int nSlices = 0;
+
+    // Time slice of each vertex, by dense vertex id
+    std::vector<int> vertexTimes;
+
+    // Dense ids of the left, right and center vertex of each triangle, 3 entries per triangle
+    std::vector<int> triangleVertices;
+
+    // Dense ids of the left, right and center neighbor of each triangle, 3 entries per triangle
+    std::vector<int> triangleNeighbors;
+
+    int nVertices() const { return static_cast<int>(vertexTimes.size()); }
+    int nTriangles() const { return static_cast<int>(triangleVertices.size()) / 3; }
+
+    // Copies the triangulation of a Universe, on the thread it is bound to
+    // Triangles keep the order of trianglesAll and vertices that of updateVertexData(),
+    // so the ids match those of a full updateData(); buffers are reused between captures
+    void capture(const Universe& universe);
+
+    // Writes the snapshot in the text format read by Universe::importGeometry()
+    void write(const std::string& geometryFilename) const;
+
+    // Writes the snapshot in the binary format (GeometryFile), header and arrays in one writev()
+    void writeBinary(const std::string& geometryFilename) const;
+
+    // Writes the snapshot (binary or text) to a temporary file next to geometryFilename,
+    // syncs it and renames it over geometryFilename
+    // A crash at any point leaves either the previous file or the new one, never a partial file
+    void save(const std::string& geometryFilename, bool binary) const;
+
+private:
+    // Dense id of each pool label, valid for the labels of the last capture
+    std::vector<int> vertexIds, triangleIds;
+};
+
+namespace GeometryFile {
+
+// Start of a binary geometry file
+struct Header {
+    char magic[8];              // "CDTGEOM\n"
+    std::uint32_t version;      // Format version
+    std::uint32_t nSlices;      // Number of time slices
+    std::uint64_t nVertices;    // Entries of the vertex time array
+    std::uint64_t nTriangles;   // Triangles, 3 entries each in the vertex and neighbor arrays
+    std::uint64_t checksum;     // FNV-1a of the three arrays, in file order
+};
+static_assert(sizeof(Header) == 40, "header layout is part of the file format");
+
+extern const char magic[8];
+const std::uint32_t version = 1;
+const std::uint64_t checksumSeed = 14695981039346656037ull;  // FNV-1a offset basis
+
+// Continues an FNV-1a checksum over size bytes
+std::uint64_t checksum(const void* data, std::size_t size, std::uint64_t hash = checksumSeed);
+
+// True if the file starts with the binary geometry magic
+bool isBinary(const std::string& geometryFilename);
+
+// True on little-endian hosts, the only ones that read and write the format
+bool littleEndian();
+
+}  // namespace GeometryFile
@@ -0,0 +1,21 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "state.hpp"        // Header for the State helpers
+#include <sstream>          // Assembling the sealed file
+#include "rng.hpp"          // Engine name in the header
+#include "snapshot.hpp"     // FNV-1a checksum (GeometryFile::checksum())
+
+namespace State {
+
+const char magic[8] = {'C', 'D', 'T', 'S', 'T', 'A', 'T', 'E'};
+
+std::string seal(const std::string& payload) {
+    std::ostringstream out;
+    out.write(magic, sizeof(magic));
+    put(out, version);
+    put(out, std::string(RngName));
+    put(out, GeometryFile::checksum(payload.data(), payload.size()));
+    out.write(payload.data(), payload.size());
+    return out.str();
+}
+
+}  // namespace State
@@ -0,0 +1,66 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * Helpers for chain state files (Simulation::saveState()). A state file is
+ * a flat binary stream of fixed-width values, strings and vectors, each
+ * vector or string preceded by its length, in host byte order. The files
+ * are read back by the same build on the same kind of machine; their header
+ * is written by seal() and checked by Simulation::restore().
+ ****/
+
+#include <cstdint>      // Length prefixes
+#include <istream>      // State input
+#include <ostream>      // State output
+#include <string>       // Strings
+#include <type_traits>  // Only trivially copyable values are written raw
+#include <vector>       // Arrays
+
+namespace State {
+
+// Chain state file: magic, version, RNG engine name and FNV-1a checksum, then the payload
+extern const char magic[8];
+const std::uint32_t version = 4;  // 2: thermalization record, 3: vertex coordination counts, 4: measurement schedule
+
+// Prepends the header to a payload; a pass over all of it, so the Checkpointer runs it on its writer thread
+std::string seal(const std::string& payload);
+
+template <class T>
+inline void put(std::ostream& out, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "written as raw bytes");
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+inline void get(std::istream& in, T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "read as raw bytes");
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+inline void put(std::ostream& out, const std::string& s) {
+    put(out, static_cast<std::uint64_t>(s.size()));
+    out.write(s.data(), s.size());
+}
+
+inline void get(std::istream& in, std::string& s) {
+    std::uint64_t size = 0;
+    get(in, size);
+    s.resize(size);
+    in.read(&s[0], size);
+}
+
+template <class T>
+inline void put(std::ostream& out, const std::vector<T>& v) {
+    put(out, static_cast<std::uint64_t>(v.size()));
+    for (const auto& x : v) put(out, x);
+}
+
+template <class T>
+inline void get(std::istream& in, std::vector<T>& v) {
+    std::uint64_t size = 0;
+    get(in, size);
+    v.resize(size);
+    for (auto& x : v) get(in, x);
+}
+
+}  // namespace State
@@ -0,0 +1,93 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "thread_pool.hpp"  // Header for ThreadPool
+
+thread_local int ThreadPool::workerIndex = -1;
+thread_local ThreadPool* ThreadPool::workerPool = nullptr;
+
+// Starts the workers, each with an empty deque
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+// Drains the pool and joins all workers
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+// Queues a task on the calling worker's deque or, from outside, round-robin
+void ThreadPool::submit(Task task) {
+    unsigned i = (workerPool == this) ? workerIndex : next++ % size();
+    // Counted before it is visible: a worker could otherwise steal and finish it first,
+    // dropping pending to 0 while the submitting task still runs, and release wait() early
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending++;
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[i]->mutex);
+        queues[i]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+// Blocks until pending drops to zero
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return pending == 0; });
+}
+
+bool ThreadPool::pop(unsigned i, Task& task) {
+    std::lock_guard<std::mutex> lock(queues[i]->mutex);
+    if (queues[i]->tasks.empty()) return false;
+    task = std::move(queues[i]->tasks.back());
+    queues[i]->tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(unsigned i, Task& task) {
+    for (unsigned k = 1; k < size(); k++) {
+        Queue& q = *queues[(i + k) % size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) continue;
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+// Worker loop: run own tasks, steal when empty, sleep when nothing is queued
+void ThreadPool::run(unsigned i) {
+    workerIndex = static_cast<int>(i);
+    workerPool = this;
+
+    Task task;
+    while (true) {
+        if (pop(i, task) || steal(i, task)) {
+            queued--;
+            task();
+            task = nullptr;     // Release captured state before reporting completion
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) idle.notify_all();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
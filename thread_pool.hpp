@@ -0,0 +1,76 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * ThreadPool is a fixed-size work-stealing thread pool.
+ * Every worker owns a task deque. A worker takes tasks from the back of its
+ * own deque and, when that is empty, steals from the front of the others.
+ * Tasks submitted from outside the pool are spread round-robin over the
+ * deques; tasks submitted from a worker go to that worker's deque.
+ ****/
+
+#include <atomic>               // Counters shared between workers
+#include <condition_variable>   // Sleeping idle workers and wait()
+#include <deque>                // Per-worker task queues
+#include <functional>           // Task type
+#include <memory>               // Owning pointers to queues
+#include <mutex>                // Queue and pool locks
+#include <thread>               // Worker threads
+#include <vector>               // Queue and worker lists
+
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // Starts the given number of workers (at least one)
+    explicit ThreadPool(unsigned threads);
+
+    // Waits for all queued tasks to finish, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task for execution
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished
+    void wait();
+
+    // Number of worker threads
+    // Counts the queues, which are complete before the first worker starts and reads it
+    unsigned size() const noexcept { return static_cast<unsigned>(queues.size()); }
+
+private:
+    // A worker's deque, guarded by its own mutex
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    // Guards sleeping, pending and stopping
+    std::mutex mutex;
+    std::condition_variable wake;   // Signals idle workers that work is available
+    std::condition_variable idle;   // Signals wait() that all tasks are done
+
+    std::atomic<int> queued{0};     // Tasks sitting in some deque
+    int pending = 0;                // Tasks submitted but not yet finished
+    bool stopping = false;          // Set by the destructor
+    std::atomic<unsigned> next{0};  // Round-robin cursor for external submissions
+
+    // Index of the calling worker in its pool, -1 outside any pool
+    static thread_local int workerIndex;
+    static thread_local ThreadPool* workerPool;
+
+    // Pops from the back of worker i's own deque
+    bool pop(unsigned i, Task& task);
+
+    // Steals from the front of another worker's deque
+    bool steal(unsigned i, Task& task);
+
+    // Main loop of worker i
+    void run(unsigned i);
+};
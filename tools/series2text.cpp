@@ -0,0 +1,40 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+/****
+ * Converts a binary observable series (outputFormat binary, series.hpp)
+ * to the text format: one line of space-separated values per measurement.
+ * Integers are printed in full and reals with 17 significant digits, so no
+ * precision is lost. With -H the header is printed first, as "#" lines.
+ *
+ * usage: series2text.x [-H] file.cdts > file.dat
+ ****/
+#include <cinttypes>        // PRId64
+#include <cstdio>           // printf
+#include <cstring>          // strcmp
+#include "../series.hpp"
+
+int main(int argc, const char* argv[]) {
+    bool header = argc > 2 && strcmp(argv[1], "-H") == 0;
+    if (argc != 2 + header) {
+        fprintf(stderr, "usage: %s [-H] file.cdts\n", argv[0]);
+        return 1;
+    }
+
+    Series::Reader series(argv[1 + header]);
+    if (header) {
+        printf("# name: %s\n", series.name.c_str());
+        printf("# identifier: %s\n", series.identifier.c_str());
+        printf("# parameters: %s\n", series.parameters.c_str());
+        printf("# %s, %u columns, %zu rows\n", series.type == Series::Int ? "int" : "real",
+               series.columns, series.rows());
+    }
+
+    for (std::size_t r = 0; r < series.rows(); r++) {
+        for (std::uint32_t c = 0; c < series.columns; c++) {
+            if (c > 0) putchar(' ');
+            if (series.type == Series::Int) printf("%" PRId64, series.ints(r)[c]);
+            else printf("%.17g", series.reals(r)[c]);
+        }
+        putchar('\n');
+    }
+    return 0;
+}
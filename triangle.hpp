@@ -8,7 +8,7 @@
 // Triangle class, inheriting from Pool for memory allocation
 class Triangle : public Pool<Triangle> {
 public:
-    // Maximum number of triangles in the pool (twice the vertex pool size, reflecting 2 triangles per vertex pair)
+    // Upper limit on the number of triangles in a pool (twice the vertex pool size, reflecting 2 triangles per vertex pair)
     static const unsigned pool_size = 2 * Vertex::pool_size;
 
     // Enum defining triangle orientation: UP (2,1)-type or DOWN (1,2)-type (Sec. 2.2)
@@ -60,6 +60,14 @@ public:
         tc_->tc = *this; // Update center neighbor’s center pointer
     }
 
+    // Sets all three neighboring triangles without updating the neighbors' pointers
+    // For bulk loading (Universe::importGeometry()), where every triangle sets its own
+    void loadTriangles(Triangle::Label tl_, Triangle::Label tr_, Triangle::Label tc_) {
+        tl = tl_;
+        tr = tr_;
+        tc = tc_;
+    }
+
     // Returns the label of the left vertex (index in Pool<Vertex>)
     Vertex::Label getVertexLeft() const noexcept { return vl; }
 
@@ -1,24 +1,58 @@
 // Copyright 2020 Joren Brunekreef and Andrzej Görlich
 #include "universe.hpp"     // Header for Universe class, managing CDT geometry
+#include "snapshot.hpp"     // Triangulation copy written by exportGeometry()
+#include <cstdio>           // Messages about unusable geometry files
+#include <cstdlib>          // exit() on unusable geometry files
+#include <cstring>          // Header copy and magic of binary geometry files
+#include <thread>           // Parallel import
+#include <fcntl.h>          // open()
+#include <sys/mman.h>       // mmap() of binary geometry files
+#include <sys/stat.h>       // File size
+#include <unistd.h>         // close()
+
+namespace {
+
+// Runs f(begin, end) over [0, n) split into one range per hardware thread
+// Small inputs run on the calling thread, where threads would cost more than they save
+template <class F>
+void parallelFor(std::size_t n, F f) {
+    std::size_t threads = std::thread::hardware_concurrency();
+    if (n < (1u << 16) || threads < 2) {
+        f(0, n);
+        return;
+    }
+    std::vector<std::thread> workers;
+    std::size_t step = (n + threads - 1) / threads;
+    for (std::size_t begin = step; begin < n; begin += step) {
+        workers.emplace_back(f, begin, std::min(begin + step, n));
+    }
+    f(0, std::min(step, n));
+    for (auto& w : workers) w.join();
+}
+
+// Reports a geometry file that cannot be imported and stops, as readState() does for state files
+void geometryError(const std::string& filename, const std::string& message) {
+    printf("%s: %s\n", filename.c_str(), message.c_str());
+    exit(1);
+}
+
+}  // namespace
+
+// Allocates this Universe's pools and bags and binds it to the calling thread
+// A triangulation with N triangles has N/2 vertices and 3N/2 links; the pools
+// get 25% headroom for volume fluctuations and grow beyond that if needed
+Universe::Universe(int targetVolume)
+    : vertexPool(targetVolume * 5 / 8), linkPool(targetVolume * 15 / 8), trianglePool(targetVolume * 5 / 4),
+      trianglesAll(rng), verticesFour(rng), trianglesFlip(rng) {
+    bind();
+}
 
-// Initialize static members of Universe class
-int Universe::nSlices = 0;  // Number of time slices, set by create() or importGeometry()
-std::vector<int> Universe::sliceSizes;  // Number of vertices per time slice
-bool Universe::sphere = false;  // Flag for spherical topology, set by config
-bool Universe::imported = false;  // Flag indicating if geometry was imported
-std::mt19937 Universe::rng;  // Upgraded to Mersenne Twister, default-constructed
-Bag<Triangle, Triangle::pool_size> Universe::trianglesAll(rng);  // Bag of all triangles (add move candidates)
-Bag<Vertex, Vertex::pool_size> Universe::verticesFour(rng);  // Bag of order-4 vertices (delete move candidates)
-Bag<Triangle, Triangle::pool_size> Universe::trianglesFlip(rng);  // Bag of flippable triangles (flip move candidates)
-
-// Lists of all simplices and their neighbors
-std::vector<Vertex::Label> Universe::vertices;  // All vertices in the triangulation
-std::vector<Link::Label> Universe::links;  // All links (edges)
-std::vector<Triangle::Label> Universe::triangles;  // All triangles
-std::vector<std::vector<Vertex::Label>> Universe::vertexNeighbors;  // Vertex neighbor lists
-std::vector<std::vector<Triangle::Label>> Universe::triangleNeighbors;  // Triangle neighbor lists
-std::vector<std::vector<Link::Label>> Universe::vertexLinks;  // Links per vertex
-std::vector<std::vector<Link::Label>> Universe::triangleLinks;  // Links per triangle
+// Makes this Universe's pools the ones Labels resolve to on the calling thread
+void Universe::bind() {
+    Vertex::bind(&vertexPool);
+    Link::bind(&linkPool);
+    Triangle::bind(&trianglePool);
+}
 
 // Creates a new CDT geometry with specified time slices
 void Universe::create(int nSlices_) {
@@ -105,6 +139,21 @@ void Universe::insertVertex(Triangle::Label t) {
     verticesFour.add(v);  // Add to order-4 vertex bag (new vertex starts with 4 triangles)
     sliceSizes[time] += 1;  // Increment slice size
 
+    // The new vertex links to the centers of t and tc, one above and one below it
+    if (coordTracking) {
+        v->up = 0;
+        v->down = 0;
+        coordUp.add(0);
+        coordDown.add(0);
+        if (t->isUpwards()) {
+            timelikeLink(v, t->getVertexCenter(), 1);
+            timelikeLink(tc->getVertexCenter(), v, 1);
+        } else {
+            timelikeLink(v, tc->getVertexCenter(), 1);
+            timelikeLink(t->getVertexCenter(), v, 1);
+        }
+    }
+
     // Update existing triangles
     t->setVertexRight(v);  // Replace right vertex with new vertex
     tc->setVertexRight(v);
@@ -131,6 +180,13 @@ void Universe::insertVertex(Triangle::Label t) {
         trianglesFlip.remove(tc);
         trianglesFlip.add(t2);
     }
+
+    if (tracking) {  // Record the changed region for updateData()
+        touch(t);
+        touch(tc);
+        touch(t1);
+        touch(t2);
+    }
 }
 
 // Removes a vertex of order 4, collapsing four triangles into two ((4,2)-move, Sec. 2.2.1)
@@ -143,6 +199,19 @@ void Universe::removeVertex(Vertex::Label v) {
     Triangle::Label trn = tr->getTriangleRight();  // Neighbor to right of tr
     Triangle::Label trcn = trc->getTriangleRight();  // Neighbor to right of trc
 
+    // Its two timelike links go with it
+    if (coordTracking) {
+        timelikeLink(v, tl->getVertexCenter(), -1);
+        timelikeLink(tlc->getVertexCenter(), v, -1);
+        coordUp.remove(v->up);
+        coordDown.remove(v->down);
+    }
+
+    if (tracking) {  // Record the region of the triangles about to be removed
+        touch(tr);
+        touch(trc);
+    }
+
     // Update connectivity: merge triangles by removing tr and trc
     tl->setTriangleRight(trn);
     tlc->setTriangleRight(trcn);
@@ -171,6 +240,11 @@ void Universe::removeVertex(Vertex::Label v) {
 
     verticesFour.remove(v);  // Remove vertex from order-4 bag
     Vertex::destroy(v);  // Free memory for vertex
+
+    if (tracking) {  // Record the merged triangles
+        touch(tl);
+        touch(tlc);
+    }
 }
 
 // Flips a timelike link between a triangle and its right neighbor ((2,2)-move, Sec. 2.2.2)
@@ -179,6 +253,11 @@ void Universe::flipLink(Triangle::Label t) {
     auto tc = t->getTriangleCenter();  // Center neighbor of t
     auto trc = tr->getTriangleCenter();  // Center neighbor of tr
 
+    if (tracking) {  // Record the region before the flip
+        touch(t);
+        touch(tr);
+    }
+
     // Update vertex pointers based on triangle orientation
     if (t->isUpwards()) {
         t->getVertexLeft()->setTriangleRight(tr);  // Adjust left vertex
@@ -198,6 +277,17 @@ void Universe::flipLink(Triangle::Label t) {
     auto vc = t->getVertexCenter();
     auto vrr = tr->getVertexRight();
 
+    // The link between vr and vc is replaced by one between vl and vrr
+    if (coordTracking) {
+        if (t->isUpwards()) {
+            timelikeLink(vr, vc, -1);
+            timelikeLink(vl, vrr, 1);
+        } else {
+            timelikeLink(vc, vr, -1);
+            timelikeLink(vrr, vl, 1);
+        }
+    }
+
     // Reassign vertices to flip the link
     t->setVertices(vc, vrr, vl);  // New t configuration
     tr->setVertices(vl, vr, vrr);  // New tr configuration
@@ -217,6 +307,60 @@ void Universe::flipLink(Triangle::Label t) {
         trianglesFlip.add(t->getTriangleLeft());  // Left neighbor now flippable
     if ((!trianglesFlip.contains(tr)) && (tr->type != tr->getTriangleRight()->type))
         trianglesFlip.add(tr);  // tr now flippable
+
+    if (tracking) {  // and after it
+        touch(t);
+        touch(tr);
+    }
+}
+
+// Moves v to the histogram bins of its new coordination numbers
+void Universe::updateVertexCoord(Vertex::Label v, int up, int down) {
+    if (up != v->up) {
+        coordUp.move(v->up, up);
+        v->up = up;
+    }
+    if (down != v->down) {
+        coordDown.move(v->down, down);
+        v->down = down;
+    }
+}
+
+// Sphere boundary links are left out, as updateVertexNeighbors() leaves them out
+void Universe::timelikeLink(Vertex::Label lower, Vertex::Label upper, int change) {
+    if (sphere && lower->time == nSlices - 1) return;
+    updateVertexCoord(lower, lower->up + change, lower->down);
+    updateVertexCoord(upper, upper->up, upper->down + change);
+}
+
+void Universe::trackCoordination(bool on) {
+    if (on && !coordTracking) countCoordination();
+    coordTracking = on;
+}
+
+// Walks the triangles above and below every vertex, as check() does
+void Universe::countCoordination() {
+    coordUp.clear();
+    coordDown.clear();
+    for (auto t : trianglesAll) {
+        if (t->isDownwards()) continue;
+        auto v = t->getVertexLeft();  // Every vertex is the left vertex of one upward triangle
+
+        // One link per triangle between v's two triangles in the strip above (below), plus one
+        int up = 1;
+        auto tn = v->getTriangleLeft()->getTriangleRight();
+        for (; tn != v->getTriangleRight(); tn = tn->getTriangleRight()) up++;
+        int down = 1;
+        tn = v->getTriangleLeft()->getTriangleCenter()->getTriangleRight();
+        for (; tn != v->getTriangleRight()->getTriangleCenter(); tn = tn->getTriangleRight()) down++;
+        v->up = up;
+        v->down = down;
+        if (sphere && v->time == nSlices - 1) v->up = 0;
+        if (sphere && v->time == 0) v->down = 0;
+
+        coordUp.add(v->up);
+        coordDown.add(v->down);
+    }
 }
 
 // Checks if a vertex has exactly 4 neighboring triangles (for delete move eligibility)
@@ -266,6 +410,12 @@ void Universe::check() {
         }
         nd++;
 
+        // Verify the tracked coordination numbers (boundary links of a sphere are not counted)
+        if (coordTracking) {
+            assert(v->up == (sphere && v->time == nSlices - 1 ? 0 : nu - 1));
+            assert(v->down == (sphere && v->time == 0 ? 0 : nd - 1));
+        }
+
         // Verify verticesFour membership
         if (nu + nd == 4) {
             assert(Universe::verticesFour.contains(v));  // Should be in bag
@@ -296,74 +446,83 @@ void Universe::updateVertexData() {
         }
     }
 
-    vertexNeighbors.clear();
+    // Lists are emptied rather than freed, so refilling them does not allocate
+    for (auto& n : vertexNeighbors) n.clear();
     vertexNeighbors.resize(max + 1);  // Resize to accommodate all vertices
     for (auto v : vertices) {
-        if (sphere) {  // Special handling for spherical topology boundaries
-            if (v->time == 0) {  // Bottom slice
-                auto tl = v->getTriangleLeft();
-                Triangle::Label tn = tl;
-                do {
-                    vertexNeighbors.at(v).push_back(tn->getVertexLeft());
-                    tn = tn->getTriangleRight();
-                } while (tn->isDownwards());
-                vertexNeighbors.at(v).push_back(tn->getVertexCenter());
-                vertexNeighbors.at(v).push_back(tn->getVertexRight());
-                continue;
-            } else if (v->time == nSlices - 1) {  // Top slice
-                auto tld = v->getTriangleLeft()->getTriangleCenter();
-                auto tn = tld;
-                do {
-                    vertexNeighbors.at(v).push_back(tn->getVertexLeft());
-                    tn = tn->getTriangleRight();
-                } while (tn->isUpwards());
-                vertexNeighbors.at(v).push_back(tn->getVertexCenter());
-                vertexNeighbors.at(v).push_back(tn->getVertexRight());
-                continue;
-            }
-        }
+        updateVertexNeighbors(v);
+    }
+}
 
-        // General case: traverse neighbors in both directions
-        auto tl = v->getTriangleLeft();
-        Triangle::Label tn = tl;
-        do {
-            vertexNeighbors.at(v).push_back(tn->getVertexLeft());
-            tn = tn->getTriangleRight();
-        } while (tn->isDownwards());
-        vertexNeighbors.at(v).push_back(tn->getVertexCenter());
-        vertexNeighbors.at(v).push_back(tn->getVertexRight());
-
-        tn = tn->getTriangleCenter()->getTriangleLeft();
-        while (tn->isUpwards()) {
-            vertexNeighbors.at(v).push_back(tn->getVertexRight());
-            tn = tn->getTriangleLeft();
+// Rebuilds the neighbor list of v by walking the triangles around it
+void Universe::updateVertexNeighbors(Vertex::Label v) {
+    auto& neighbors = vertexNeighbors.at(v);
+    neighbors.clear();
+
+    if (sphere) {  // Special handling for spherical topology boundaries
+        if (v->time == 0) {  // Bottom slice
+            auto tl = v->getTriangleLeft();
+            Triangle::Label tn = tl;
+            do {
+                neighbors.push_back(tn->getVertexLeft());
+                tn = tn->getTriangleRight();
+            } while (tn->isDownwards());
+            neighbors.push_back(tn->getVertexCenter());
+            neighbors.push_back(tn->getVertexRight());
+            return;
+        } else if (v->time == nSlices - 1) {  // Top slice
+            auto tld = v->getTriangleLeft()->getTriangleCenter();
+            auto tn = tld;
+            do {
+                neighbors.push_back(tn->getVertexLeft());
+                tn = tn->getTriangleRight();
+            } while (tn->isUpwards());
+            neighbors.push_back(tn->getVertexCenter());
+            neighbors.push_back(tn->getVertexRight());
+            return;
         }
-        vertexNeighbors.at(v).push_back(tn->getVertexCenter());
     }
+
+    // General case: traverse neighbors in both directions
+    auto tl = v->getTriangleLeft();
+    Triangle::Label tn = tl;
+    do {
+        neighbors.push_back(tn->getVertexLeft());
+        tn = tn->getTriangleRight();
+    } while (tn->isDownwards());
+    neighbors.push_back(tn->getVertexCenter());
+    neighbors.push_back(tn->getVertexRight());
+
+    tn = tn->getTriangleCenter()->getTriangleLeft();
+    while (tn->isUpwards()) {
+        neighbors.push_back(tn->getVertexRight());
+        tn = tn->getTriangleLeft();
+    }
+    neighbors.push_back(tn->getVertexCenter());
 }
 
 // Updates link data (edges) for measurement
+// Link objects of the previous call are reused in order; only the
+// difference in count is created or destroyed
 void Universe::updateLinkData() {
-    // Clear existing links
-    for (auto l : links) {
-        Link::destroy(l);
-    }
-    links.clear();
+    int used = 0;  // Links of the previous call reused so far
+    auto nextLink = [this, &used]() {
+        if (used == static_cast<int>(links.size())) links.push_back(Link::create());
+        return links[used++];
+    };
     int max = 0;
 
-    // Resize adjacency lists
-    vertexLinks.clear();
-    for (auto i = 0u; i < vertexNeighbors.size(); i++) {
-        vertexLinks.push_back({});
-    }
-    triangleLinks.clear();
-    for (auto i = 0u; i < triangleNeighbors.size(); i++) {
-        triangleLinks.push_back({-1, -1, -1});  // Three links per triangle (left, right, center)
+    // Resize adjacency lists, keeping their storage
+    for (auto& l : vertexLinks) l.clear();
+    vertexLinks.resize(vertexNeighbors.size());
+    triangleLinks.resize(triangleNeighbors.size());
+    for (auto& l : triangleLinks) {
+        l.assign(3, -1);  // Three links per triangle (left, right, center)
     }
 
     // Create links for all triangles
     for (auto t : trianglesAll) {
-        auto ll = Link::create();  // Left timelike link
+        auto ll = nextLink();  // Left timelike link
         if (t->isUpwards()) ll->setVertices(t->getVertexLeft(), t->getVertexCenter());
         else if (t->isDownwards()) ll->setVertices(t->getVertexCenter(), t->getVertexLeft());
         ll->setTriangles(t->getTriangleLeft(), t);  // Connect to left neighbor
@@ -373,11 +532,10 @@ void Universe::updateLinkData() {
 
         triangleLinks.at(t).at(0) = ll;  // Left link slot
         triangleLinks.at(t->getTriangleLeft()).at(1) = ll;  // Right link slot of left neighbor
-        links.push_back(ll);
         if (ll > max) max = ll;
 
         if (t->isUpwards()) {  // Horizontal spacelike link for upward triangles
-            auto lh = Link::create();
+            auto lh = nextLink();
             lh->setVertices(t->getVertexLeft(), t->getVertexRight());
             lh->setTriangles(t, t->getTriangleCenter());
 
@@ -387,11 +545,16 @@ void Universe::updateLinkData() {
             triangleLinks.at(t).at(2) = lh;  // Center link slot
             triangleLinks.at(t->getTriangleCenter()).at(2) = lh;
 
-            links.push_back(lh);
             if (lh > max) max = lh;
         }
     }
 
+    // Release links left over from a larger triangulation
+    for (auto i = used; i < static_cast<int>(links.size()); i++) {
+        Link::destroy(links[i]);
+    }
+    links.resize(used);
+
     assert(links.size() == 3 * vertices.size());  // Verify link count (triangular lattice property)
 }
 
@@ -404,86 +567,155 @@ void Universe::updateTriangleData() {
         if (t > max) max = t;  // Track maximum triangle label
     }
 
-    triangleNeighbors.clear();
+    for (auto& n : triangleNeighbors) n.clear();
     triangleNeighbors.resize(max + 1);  // Resize to accommodate all triangles
     for (auto t : trianglesAll) {
-        if (sphere) {  // Special handling for boundary triangles in spherical topology
-            if (t->isUpwards() && t->time == 0) {
-                triangleNeighbors.at(t) = {t->getTriangleLeft(), t->getTriangleRight()};
-                continue;
-            }
-            if (t->isDownwards() && t->time == nSlices - 1) {
-                triangleNeighbors.at(t) = {t->getTriangleLeft(), t->getTriangleRight()};
-                continue;
-            }
+        updateTriangleNeighbors(t);
+    }
+}
+
+// Rebuilds the neighbor list of t
+void Universe::updateTriangleNeighbors(Triangle::Label t) {
+    if (sphere) {  // Special handling for boundary triangles in spherical topology
+        if ((t->isUpwards() && t->time == 0) || (t->isDownwards() && t->time == nSlices - 1)) {
+            triangleNeighbors.at(t) = {t->getTriangleLeft(), t->getTriangleRight()};
+            return;
         }
+    }
 
-        // General case: all three neighbors
-        triangleNeighbors.at(t) = {t->getTriangleLeft(), t->getTriangleRight(), t->getTriangleCenter()};    }
+    // General case: all three neighbors
+    triangleNeighbors.at(t) = {t->getTriangleLeft(), t->getTriangleRight(), t->getTriangleCenter()};
 }
 
-// Exports current geometry to a file for checkpointing
-void Universe::exportGeometry(std::string geometryFilename) {
-    std::unordered_map<int, int> vertexMap;  // Map vertex labels to indices
-    std::vector<Vertex::Label> intVMap;  // Reverse mapping for writing
-    intVMap.resize(vertices.size());
-
-    int i = 0;
-    for (auto v : vertices) {
-        vertexMap.insert({v, i});  // Assign index to vertex
-        intVMap.at(i) = v;
-        i++;
+// Brings the measurement data up to date, fully or incrementally
+void Universe::updateData() {
+    if (!incremental || !tracking) {
+        updateVertexData();    // Refresh vertex neighbor lists
+        updateTriangleData();  // Refresh triangle neighbor lists
+        updateLinkData();      // Refresh link data (edges)
+        updateGraphs();
+        if (!incremental) return;
+
+        // Index the full lists; from now on moves record what they touch
+        vertexPosition.assign(vertexNeighbors.size(), -1);
+        for (auto i = 0u; i < vertices.size(); i++) vertexPosition[vertices[i]] = i;
+        trianglePosition.assign(triangleNeighbors.size(), -1);
+        for (auto i = 0u; i < triangles.size(); i++) trianglePosition[triangles[i]] = i;
+        for (auto v : dirtyVertices) vertexDirty[v] = false;
+        for (auto t : dirtyTriangles) triangleDirty[t] = false;
+        dirtyVertices.clear();
+        dirtyTriangles.clear();
+        tracking = true;
+        return;
     }
 
-    std::unordered_map<int, int> triangleMap;  // Map triangle labels to indices
-    std::vector<Triangle::Label> intTMap;
-    intTMap.resize(triangles.size());
+    // Dirty labels are either live simplices, whose lists are rebuilt and which are
+    // added to vertices/triangles if new, or destroyed ones, which are removed
+    // (swapping the last element into their place)
+    if (vertexNeighbors.size() < static_cast<std::size_t>(Vertex::pool_capacity())) {
+        vertexNeighbors.resize(Vertex::pool_capacity());
+        vertexPosition.resize(Vertex::pool_capacity(), -1);
+    }
+    for (auto v : dirtyVertices) {
+        vertexDirty[v] = false;
+        int& position = vertexPosition[v];
+        if (Vertex::active(v)) {
+            if (position == -1) {
+                position = vertices.size();
+                vertices.push_back(v);
+            }
+            updateVertexNeighbors(v);
+        } else if (position != -1) {
+            auto last = vertices.back();
+            vertices[position] = last;
+            vertexPosition[last] = position;
+            vertices.pop_back();
+            position = -1;
+            vertexNeighbors[v].clear();
+        }
+    }
+    dirtyVertices.clear();
 
-    i = 0;
-    for (auto t : triangles) {
-        triangleMap.insert({t, i});  // Assign index to triangle
-        intTMap.at(i) = t;
-        i++;
+    if (triangleNeighbors.size() < static_cast<std::size_t>(Triangle::pool_capacity())) {
+        triangleNeighbors.resize(Triangle::pool_capacity());
+        trianglePosition.resize(Triangle::pool_capacity(), -1);
     }
+    for (auto t : dirtyTriangles) {
+        triangleDirty[t] = false;
+        int& position = trianglePosition[t];
+        if (trianglesAll.contains(t)) {
+            if (position == -1) {
+                position = triangles.size();
+                triangles.push_back(t);
+            }
+            updateTriangleNeighbors(t);
+        } else if (position != -1) {
+            auto last = triangles.back();
+            triangles[position] = last;
+            trianglePosition[last] = position;
+            triangles.pop_back();
+            position = -1;
+            triangleNeighbors[t].clear();
+        }
+    }
+    dirtyTriangles.clear();
 
-    std::string output;
-    output += std::to_string(vertices.size()) + "\n";  // Write vertex count
+    // Links and graphs are rebuilt in full, reusing their storage: the graphs are packed
+    // arrays without room for rows to change length, and GeometrySnapshot copies them
+    // whole anyway. The update therefore remains O(N), with a smaller constant.
+    updateLinkData();
+    updateGraphs();
+}
 
-    // Write vertex times
-    for (int j = 0; j < intVMap.size(); j++) {
-        output += std::to_string(intVMap.at(j)->time) + "\n";
-    }
+// Packs the neighbor lists into the CSR graphs read by observables
+void Universe::updateGraphs() {
+    vertexGraph.build(vertices, vertexNeighbors);
+    triangleGraph.build(triangles, triangleNeighbors);
+}
 
-    output += std::to_string(vertices.size()) + "\n";  // Vertex count again (format quirk)
-    output += std::to_string(triangles.size()) + "\n";  // Triangle count
+// Records t, its neighbors and its vertices for the next incremental update
+void Universe::touch(Triangle::Label t) {
+    markDirty(t);
+    markDirty(t->getTriangleLeft());
+    markDirty(t->getTriangleRight());
+    markDirty(t->getTriangleCenter());
+    markDirty(t->getVertexLeft());
+    markDirty(t->getVertexRight());
+    markDirty(t->getVertexCenter());
+}
 
-    // Write triangle data (vertices and neighbors)
-    for (int j = 0; j < intTMap.size(); j++) {
-        Triangle::Label t = intTMap.at(j);
-        Vertex::Label tVs[3] = {t->getVertexLeft(), t->getVertexRight(), t->getVertexCenter()};
-        for (auto v : tVs) {
-            output += std::to_string(vertexMap.at(v)) + "\n";  // Vertex indices
-        }
-        Triangle::Label tNeighb[3] = {t->getTriangleLeft(), t->getTriangleRight(), t->getTriangleCenter()};
-        for (auto t : tNeighb) {
-            output += std::to_string(triangleMap.at(t)) + "\n";  // Neighbor indices
-        }
-    }
+void Universe::markDirty(Vertex::Label v) {
+    if (v >= static_cast<int>(vertexDirty.size())) vertexDirty.resize(Vertex::pool_capacity(), false);
+    if (vertexDirty[v]) return;
+    vertexDirty[v] = true;
+    dirtyVertices.push_back(v);
+}
 
-    output += std::to_string(triangles.size());  // Triangle count again (format quirk)
+void Universe::markDirty(Triangle::Label t) {
+    if (t >= static_cast<int>(triangleDirty.size())) triangleDirty.resize(Triangle::pool_capacity(), false);
+    if (triangleDirty[t]) return;
+    triangleDirty[t] = true;
+    dirtyTriangles.push_back(t);
+}
 
-    // Write to file
-    std::ofstream file;
-    file.open(geometryFilename, std::ios::out | std::ios::trunc);  // Overwrite mode
-    assert(file.is_open());
-    file << output << "\n";
-    file.close();
+// Exports current geometry to a file for checkpointing
+// Works from the bags, so the measurement data need not be up to date;
+// the file is replaced atomically (TriangulationSnapshot::save())
+void Universe::exportGeometry(std::string geometryFilename) {
+    TriangulationSnapshot snapshot;
+    snapshot.capture(*this);
+    snapshot.save(geometryFilename, binaryGeometry);
 
     std::cout << geometryFilename << "\n";  // Log export
 }
 
 // Imports a geometry from a file, reconstructing the triangulation
 void Universe::importGeometry(std::string geometryFilename) {
+    if (GeometryFile::isBinary(geometryFilename)) {
+        importBinaryGeometry(geometryFilename);
+        return;
+    }
+
     std::ifstream infile(geometryFilename.c_str());
     assert(!infile.fail());  // Ensure file exists
     int line;
@@ -551,19 +783,151 @@ void Universe::importGeometry(std::string geometryFilename) {
     imported = true;  // Mark as imported
 }
 
+// Imports a binary geometry file without copying it: the arrays are read from the mapping
+// Simplices are created in file order, so labels equal file ids, as in the text import.
+// Connectivity is then set and the bag candidates found on several threads; the bags
+// are filled afterwards in the order of the text import, so a chain continues identically.
+void Universe::importBinaryGeometry(const std::string& geometryFilename) {
+    assert(GeometryFile::littleEndian());
+    assert(Vertex::size() == 0 && Triangle::size() == 0);  // Labels must start at 0
+
+    int fd = open(geometryFilename.c_str(), O_RDONLY);
+    if (fd < 0) geometryError(geometryFilename, "cannot open geometry file");
+    struct stat st;
+    fstat(fd, &st);
+    std::size_t size = st.st_size;
+    if (size < sizeof(GeometryFile::Header)) geometryError(geometryFilename, "truncated geometry file");
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) geometryError(geometryFilename, "cannot map geometry file");
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    // Header and size are checked before anything past the header is read
+    GeometryFile::Header header;
+    std::memcpy(&header, map, sizeof(header));
+    if (std::memcmp(header.magic, GeometryFile::magic, sizeof(header.magic)) != 0) {
+        geometryError(geometryFilename, "not a binary geometry file");
+    }
+    if (header.version != GeometryFile::version) {
+        geometryError(geometryFilename, "unsupported version " + std::to_string(header.version));
+    }
+    std::size_t entries = (size - sizeof(header)) / sizeof(int);
+    std::size_t nV = header.nVertices, nT = header.nTriangles;
+    // Compared without forming nV + 6 * nT, which a corrupt header could overflow
+    if ((size - sizeof(header)) % sizeof(int) != 0 || nV > entries || nT > (entries - nV) / 6
+        || nV + 6 * nT != entries) {
+        geometryError(geometryFilename, "size does not match the vertex and triangle counts");
+    }
+
+    const int* times = reinterpret_cast<const int*>(static_cast<const char*>(map) + sizeof(header));
+    const int* tVs = times + nV;
+    const int* tNeighb = tVs + 3 * nT;
+    if (GeometryFile::checksum(times, size - sizeof(header)) != header.checksum) {
+        geometryError(geometryFilename, "checksum mismatch, geometry file is corrupt");
+    }
+    // The checksum catches damage, not a file written wrong; labels index the pools directly
+    for (std::size_t i = 0; i < nV; i++) {
+        if (times[i] < 0 || times[i] >= static_cast<int>(header.nSlices)) {
+            geometryError(geometryFilename, "vertex time out of range");
+        }
+    }
+    for (std::size_t i = 0; i < 3 * nT; i++) {
+        if (tVs[i] < 0 || static_cast<std::size_t>(tVs[i]) >= nV || tNeighb[i] < 0
+            || static_cast<std::size_t>(tNeighb[i]) >= nT) {
+            geometryError(geometryFilename, "vertex or triangle label out of range");
+        }
+    }
+
+    nSlices = header.nSlices;
+    sliceSizes.assign(nSlices, 0);
+    for (std::size_t i = 0; i < nV; i++) {
+        auto v = Vertex::create();
+        v->time = times[i];
+        sliceSizes.at(v->time)++;
+    }
+    for (std::size_t i = 0; i < nT; i++) {
+        trianglesAll.add(Triangle::create());
+    }
+
+    // Every triangle sets its own fields and those of its vertices it is the upward triangle of;
+    // each vertex is the left and the right vertex of exactly one upward triangle, so no field is shared
+    std::vector<char> four(nT), flip(nT);
+    parallelFor(nT, [&](std::size_t begin, std::size_t end) {
+        bind();
+        for (auto i = begin; i < end; i++) {
+            Triangle::Label t = static_cast<int>(i);
+            t->setVertices(tVs[3 * i], tVs[3 * i + 1], tVs[3 * i + 2]);
+            t->loadTriangles(tNeighb[3 * i], tNeighb[3 * i + 1], tNeighb[3 * i + 2]);
+        }
+    });
+    parallelFor(nT, [&](std::size_t begin, std::size_t end) {
+        bind();
+        for (auto i = begin; i < end; i++) {
+            Triangle::Label t = static_cast<int>(i);
+            if (t->isUpwards()) {
+                auto v = t->getVertexLeft();
+                four[i] = v->getTriangleLeft() == v->getTriangleRight()->getTriangleLeft()
+                    && v->getTriangleLeft()->getTriangleCenter() == v->getTriangleRight()->getTriangleCenter()->getTriangleLeft();
+            }
+            flip[i] = t->type != t->getTriangleRight()->type;
+        }
+    });
+    munmap(map, size);
+
+    printf("read %s\n", geometryFilename.c_str());  // Log import
+    if (sphere) assert(sliceSizes.at(0) == 3);  // Verify spherical boundary
+
+    for (auto t : trianglesAll) {
+        if (four[t]) verticesFour.add(t->getVertexLeft());
+        if (flip[t]) trianglesFlip.add(t);
+    }
+
+    check();  // Validate imported geometry
+    imported = true;  // Mark as imported
+}
+
 // Generates a standardized filename for geometry files
 std::string Universe::getGeometryFilename(int targetVolume, int slices, int seed) {
     std::string expectedFn = "geom/geometry-v" + std::to_string(targetVolume) +
                             "-t" + std::to_string(slices) +
                             "-s" + std::to_string(seed);
+    if (!geometryTag.empty()) expectedFn += "-" + geometryTag;  // Append tag if set
     if (sphere) expectedFn += "-sphere";  // Append spherical flag if set
-    expectedFn += ".dat";  // File extension
+    expectedFn += binaryGeometry ? ".cdtg" : ".dat";  // File extension by format
     return expectedFn;
 }
 
-// Add at the end of the file
-void Universe::seedRNG(int seed, int offset) {
-    // Combine seed and offset, ensuring the result fits within result_type
-    std::mt19937::result_type combined_seed = static_cast<std::mt19937::result_type>(seed) + offset;
-    rng.seed(combined_seed);
+// Geometry filename with the format's extension replaced
+std::string Universe::getStateFilename(int targetVolume, int slices, int seed) {
+    std::string fn = getGeometryFilename(targetVolume, slices, seed);
+    return fn.substr(0, fn.rfind('.')) + ".state";
+}
+
+// Slices, pools and bags; the RNG is saved by the Simulation with the other streams
+void Universe::saveState(std::ostream& out) const {
+    State::put(out, nSlices);
+    State::put(out, sliceSizes);
+    vertexPool.save(out);
+    trianglePool.save(out);
+    trianglesAll.save(out);
+    verticesFour.save(out);
+    trianglesFlip.save(out);
+}
+
+void Universe::loadState(std::istream& in) {
+    State::get(in, nSlices);
+    State::get(in, sliceSizes);
+    vertexPool.load(in);
+    trianglePool.load(in);
+    trianglesAll.load(in);
+    verticesFour.load(in);
+    trianglesFlip.load(in);
+
+    check();  // Validate restored geometry
+    imported = true;  // Skips growth and thermalization, as for an imported geometry
+}
+
+// Keys the bags' RNG to its own stream
+void Universe::seedRNG(std::uint64_t seed, std::uint32_t chain, std::uint32_t stream) {
+    Random::seed(rng, seed, chain, stream);
 }
\ No newline at end of file
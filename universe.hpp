@@ -11,107 +11,231 @@
 #include "triangle.hpp"     // Triangle class: 2D simplices (building blocks of CDT)
 #include "pool.hpp"         // Pool structure for O(1) simplex management
 #include "bag.hpp"          // Bag structure for random access to simplices
-
+#include "graph.hpp"        // CSR adjacency consumed by observables
+#include "histogram.hpp"    // Running maxima of the coordination numbers
+#include "rng.hpp"          // Random number engine
+
+/****
+ * A Universe is one CDT triangulation together with the pools that hold its
+ * simplices, the bags used by the Monte Carlo moves and its own RNG.
+ * Several Universes can live in one process (e.g. one per thread). Simplex
+ * Labels are dereferenced through the pools bound to the current thread,
+ * so call bind() on the thread that works with a Universe before touching
+ * its geometry. The constructor binds the new Universe to the calling thread.
+ ****/
 class Universe {
 public:
+    // Allocates the pools and binds them to the calling thread
+    // targetVolume: expected number of triangles, used to size the pools up front
+    // (they grow on demand, so 0 or a rough estimate is fine)
+    explicit Universe(int targetVolume = 0);
+
+    // A Universe owns its pools and bags, so it cannot be copied
+    Universe(const Universe&) = delete;
+    Universe& operator=(const Universe&) = delete;
+
+    // Makes this Universe's pools the ones used by Labels on the calling thread
+    void bind();
+
     // Number of time slices in the CDT geometry (set by create() or config)
-    static int nSlices;
+    int nSlices = 0;
 
     // Size (number of vertices) of each time slice, indexed by time
-    static std::vector<int> sliceSizes;
+    std::vector<int> sliceSizes;
 
     // Flag to enforce spherical topology (optional, set by config)
-    static bool sphere;
+    bool sphere = false;
 
     // Flag indicating if geometry was imported from a file (set by importGeometry())
-    static bool imported;
+    bool imported = false;
+
+    // Optional suffix distinguishing geometry files of runs that share volume,
+    // slices and seed (e.g. "l0.693147" for the chains of an ensemble)
+    std::string geometryTag;
+
+    // Patch the neighbor lists in place instead of rebuilding them (see updateData())
+    bool incremental = false;
+
+    // Export geometry in the binary format (GeometryFile in snapshot.hpp) instead of text
+    // Also picks the extension of getGeometryFilename(); import detects the format itself
+    bool binaryGeometry = false;
+
+private:
+    // Pools holding this Universe's simplices (declared before the bags that index into them)
+    Vertex::Arena vertexPool;
+    Link::Arena linkPool;
+    Triangle::Arena trianglePool;
+
+    // Random number generator for geometry operations (e.g., Bag::pick())
+    Rng rng;
+
+public:
 
     // Bag of all triangles, candidates for the add move ((2,4)-move, Sec. 2.2.1)
-    static Bag<Triangle, Triangle::pool_size> trianglesAll;
+    Bag<Triangle> trianglesAll;
 
     // Bag of vertices with coordination number 4, candidates for the delete move ((4,2)-move, Sec. 2.2.1)
-    static Bag<Vertex, Vertex::pool_size> verticesFour;
+    Bag<Vertex> verticesFour;
 
     // Bag of triangles with a right neighbor of opposite type, candidates for the flip move ((2,2)-move, Sec. 2.2.2)
-    static Bag<Triangle, Triangle::pool_size> trianglesFlip;
+    Bag<Triangle> trianglesFlip;
 
-    // Initializes static data structures (e.g., bags, vectors) before simulation
-    static void initialize();
+    // Distribution of the vertices' timelike links up (Vertex::up) and down (Vertex::down)
+    // Kept by the moves while trackCoordination() is on, so max() gives the largest
+    // coordination without a scan
+    // On a sphere the links between the last slice and slice 0 are not counted
+    Histogram coordUp, coordDown;
+
+    // Switches the upkeep of coordUp and coordDown on or off
+    // On counts all vertices once; the moves then update them, which slows them down
+    // by a fifth or so, so it is only on while Simulation::thermalize() needs it
+    void trackCoordination(bool on);
+
+    // Builds the initial triangulation (a minimal toroidal strip) for create()
+    void initialize();
 
     // Creates a new CDT geometry with specified number of time slices
     // n_slices: number of discrete time steps in the triangulation
-    static void create(int n_slices);
+    void create(int n_slices);
 
     // Monte Carlo moves (Sec. 2.2)
 
     // Inserts a vertex into a triangle, splitting it into four triangles ((2,4)-move)
-    static void insertVertex(Triangle::Label t);
+    void insertVertex(Triangle::Label t);
 
     // Removes a vertex of order four, collapsing four triangles into two ((4,2)-move)
-    static void removeVertex(Vertex::Label v);
+    void removeVertex(Vertex::Label v);
 
     // Enum to specify flip direction (left or right neighbor) for flipLink()
     enum flipSide { LEFT, RIGHT };
 
     // Flips a timelike link adjacent to a vertex, specified by direction
-    static void flipLink(Vertex::Label v, flipSide side);
+    void flipLink(Vertex::Label v, flipSide side);
 
     // Flips a timelike link shared by a triangle and its right neighbor ((2,2)-move)
-    static void flipLink(Triangle::Label t);
+    void flipLink(Triangle::Label t);
 
     // Bag consistency functions
 
-    // Updates a vertex’s coordination numbers (up/down) and adjusts verticesFour bag
+    // Updates a vertex’s coordination numbers (up/down) and moves it between the bins of
+    // coordUp and coordDown; verticesFour is kept by the moves themselves
     // v: vertex to update, up/down: number of upward/downward connections
-    static void updateVertexCoord(Vertex::Label v, int up, int down);
+    void updateVertexCoord(Vertex::Label v, int up, int down);
 
     // Checks if a vertex has coordination number 4 (eligible for delete move)
     static bool isFourVertex(Vertex::Label v);
 
     // Verifies integrity of the triangulation (e.g., manifold conditions, Sec. 1.3)
-    static void check();
+    void check();
 
     // Updates connectivity data for measurement (Sec. 3.2.1)
 
     // Refreshes vertex neighbor lists (vertexNeighbors)
-    static void updateVertexData();
+    void updateVertexData();
 
     // Refreshes link data (vertexLinks, triangleLinks)
-    static void updateLinkData();
+    void updateLinkData();
 
     // Refreshes triangle neighbor lists (triangleNeighbors)
-    static void updateTriangleData();
+    void updateTriangleData();
+
+    // Brings vertices, triangles, neighbor lists and link data up to date
+    // Rebuilds everything, or with incremental set (after the first call) only the neighbor
+    // lists of the simplices touched by moves since the previous call. The link data and the
+    // CSR graphs are rebuilt in full either way, so an update stays O(N); only the per-simplex
+    // fan walks are skipped. Incremental updates keep vertices and triangles in a different
+    // order than a full rebuild would.
+    void updateData();
 
     // Exports current geometry to a file for checkpointing or reuse
-    static void exportGeometry(std::string geometryFilename);
+    // Writes a TriangulationSnapshot, so it needs no prior updateData()
+    void exportGeometry(std::string geometryFilename);
 
     // Imports a saved geometry from a file, bypassing creation
-    static void importGeometry(std::string geometryFilename);
+    // Accepts both formats; binary files are memory-mapped and checked against their checksum
+    // The Universe must be empty
+    void importGeometry(std::string geometryFilename);
 
     // Generates a standardized filename for geometry based on parameters
     // targetVolume: target number of triangles, slices: time slices, seed: RNG seed
-    static std::string getGeometryFilename(int targetVolume, int slices, int seed);
+    std::string getGeometryFilename(int targetVolume, int slices, int seed);
+
+    // Chain state file kept next to the geometry checkpoint (Simulation::saveState())
+    // Same name as getGeometryFilename() with the extension ".state"
+    std::string getStateFilename(int targetVolume, int slices, int seed);
 
     // Lists of all simplices in the triangulation (populated during simulation)
-    static std::vector<Vertex::Label> vertices;       // All vertices
-    static std::vector<Link::Label> links;           // All links (edges)
-    static std::vector<Triangle::Label> triangles;   // All triangles
+    std::vector<Vertex::Label> vertices;       // All vertices
+    std::vector<Link::Label> links;           // All links (edges)
+    std::vector<Triangle::Label> triangles;   // All triangles
 
     // Neighbor adjacency lists (reconstructed by update*Data() for measurements)
-    static std::vector<std::vector<Vertex::Label>> vertexNeighbors;    // Neighbors of each vertex
-    static std::vector<std::vector<Triangle::Label>> triangleNeighbors; // Neighbors of each triangle
+    std::vector<std::vector<Vertex::Label>> vertexNeighbors;    // Neighbors of each vertex
+    std::vector<std::vector<Triangle::Label>> triangleNeighbors; // Neighbors of each triangle
+
+    // Compact adjacency of the vertices and of the triangles (dual lattice), built by updateData()
+    // Dense ids follow the order of vertices and triangles; observables traverse these
+    Graph vertexGraph;
+    Graph triangleGraph;
 
     // Link adjacency lists (used for connectivity and measurements)
-    static std::vector<std::vector<Link::Label>> vertexLinks;     // Links connected to each vertex
-    static std::vector<std::vector<Link::Label>> triangleLinks;   // Links bordering each triangle
+    std::vector<std::vector<Link::Label>> vertexLinks;     // Links connected to each vertex
+    std::vector<std::vector<Link::Label>> triangleLinks;   // Links bordering each triangle
+
+    // Keys the RNG used by the bags to the stream (seed, chain, stream)
+    void seedRNG(std::uint64_t seed, std::uint32_t chain, std::uint32_t stream = Random::Universe);
+
+    // State of the bags' RNG, saved and restored by Simulation
+    std::string rngState() const { return Random::state(rng); }
+    void restoreRNG(const std::string& state) { Random::restore(rng, state); }
 
-    // Added method to seed the RNG
-    static void seedRNG(int seed, int offset = 0);  // Updated declaration
+    // Writes the triangulation as the sampler sees it: slices, the raw vertex and triangle
+    // pools and the bag orders, so that moves after loadState() repeat exactly
+    // Links and the measurement data are not saved; updateData() rebuilds them
+    void saveState(std::ostream& out) const;
+
+    // Restores what saveState() wrote into an empty Universe bound to the calling thread
+    void loadState(std::istream& in);
 
 private:
-    // Private default constructor to prevent instantiation (Universe is static-only)
-    Universe() {}
+    // Builds the triangulation from a mapped binary geometry file (called by importGeometry())
+    void importBinaryGeometry(const std::string& geometryFilename);
+
+    // Set by trackCoordination(); moves then update the coordination numbers
+    bool coordTracking = false;
+
+    // Counts the coordination numbers of all vertices and refills coordUp and coordDown
+    void countCoordination();
+
+    // Adds (change 1) or removes (change -1) a timelike link from lower to upper
+    // in both vertices' coordination numbers
+    void timelikeLink(Vertex::Label lower, Vertex::Label upper, int change);
+
+    // Incremental updates (updateData() with incremental set)
+
+    // Set once a full update has been done; moves then record the simplices they touch
+    bool tracking = false;
+
+    // Simplices whose neighbor lists may have changed since the last updateData()
+    std::vector<Vertex::Label> dirtyVertices;
+    std::vector<Triangle::Label> dirtyTriangles;
+
+    // Membership flags of the dirty lists, indexed by label
+    std::vector<char> vertexDirty, triangleDirty;
+
+    // Index of each label in vertices and triangles, -1 if absent
+    std::vector<int> vertexPosition, trianglePosition;
+
+    // Records t, its neighbors and its vertices as dirty
+    // Moves call it on every triangle they modify, before and after the change
+    void touch(Triangle::Label t);
+    void markDirty(Vertex::Label v);
+    void markDirty(Triangle::Label t);
+
+    // Rebuilds the neighbor list of a single simplex
+    void updateVertexNeighbors(Vertex::Label v);
+    void updateTriangleNeighbors(Triangle::Label t);
 
-    // Random number generator for geometry operations (e.g., initial creation)
-    static std::mt19937 rng;  // Upgraded to Mersenne Twister for better randomness
+    // Rebuilds vertexGraph and triangleGraph from the neighbor lists
+    void updateGraphs();
 };
\ No newline at end of file
@@ -9,12 +9,17 @@ class Triangle;
 // Vertex class, inheriting from Pool for efficient memory allocation
 class Vertex : public Pool<Vertex> {
 public:
-    // Maximum number of vertices that can be stored in the pool (10 million)
+    // Upper limit on the number of vertices in a pool (10 million); pools grow up to it
     static const unsigned pool_size = 10000000;
 
     // Time slice index where this vertex resides (0 to nSlices-1)
     int time;
 
+    // Timelike links to the next (up) and the previous (down) slice
+    // Kept up to date by the Universe's moves while Universe::trackCoordination() is on
+    int up;
+    int down;
+
     // Returns the label (index) of the left neighboring triangle
     // This is one of the upward triangles containing the vertex
     Pool<Triangle>::Label getTriangleLeft();
@@ -0,0 +1,155 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#include "writer.hpp"       // Header for OutputWriter
+#include <cassert>          // File checks
+#include <cerrno>           // Retrying interrupted writes
+#include <cstdio>           // Error messages
+#include <cstdlib>          // exit() on deleted or unwritable files
+#include <algorithm>        // std::find on the unsynced list
+#include <fcntl.h>          // open()
+#include <sys/stat.h>       // fstat() to detect deleted files
+#include <unistd.h>         // write(), fsync(), ftruncate(), close()
+
+// Stops the writer after a last round and closes the files
+OutputWriter::~OutputWriter() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+    for (auto& f : files) close(f.fd);
+}
+
+// Opens (or truncates) a file, starting the writer on first use
+int OutputWriter::open(const std::string& filename, std::uint64_t keep) {
+    flush();  // Nothing of an earlier run may land after the truncation
+    std::lock_guard<std::mutex> lock(mutex);
+    int i = 0;
+    while (i < static_cast<int>(files.size()) && files[i].name != filename) i++;
+    if (i == static_cast<int>(files.size())) {
+        int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        assert(fd >= 0);  // Ensure file opened successfully
+        files.push_back({filename, fd, "", 0});
+    }
+
+    struct stat st;
+    fstat(files[i].fd, &st);
+    if (static_cast<std::uint64_t>(st.st_size) < keep) {
+        printf("%s is shorter than at the checkpoint\n", filename.c_str());
+        exit(1);
+    }
+    int truncated = ftruncate(files[i].fd, keep);
+    assert(truncated == 0);
+    files[i].size = keep;
+
+    if (!thread.joinable()) thread = std::thread(&OutputWriter::run, this);
+    return i;
+}
+
+std::uint64_t OutputWriter::size(int file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return files[file].size;
+}
+
+// Adds a record to the file's buffer and wakes the writer once a batch is full
+void OutputWriter::add(int file, const char* data, std::size_t size, bool newline) {
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& buffer = files[file].buffer;
+        buffer.append(data, size);
+        if (newline) buffer += '\n';
+        buffered += size + newline;
+        files[file].size += size + newline;
+        full = buffered >= batchBytes;
+    }
+    if (full) wake.notify_one();
+}
+
+// Requests a write round and waits until it has finished
+void OutputWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!thread.joinable()) return;
+    long round = ++requested;
+    wake.notify_one();
+    done.wait(lock, [this, round] { return written >= round; });
+}
+
+// The writer may append meanwhile; only the records flushed before matter
+void OutputWriter::sync() {
+    flush();
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& f : files) fds.push_back(f.fd);
+    }
+    for (auto fd : fds) {
+        int synced;
+        while ((synced = fsync(fd)) != 0 && errno == EINTR) {}
+        if (synced != 0) {
+            perror("observable output");
+            exit(1);
+        }
+    }
+}
+
+// Takes all buffers under the lock, then writes (and syncs) them without it
+void OutputWriter::run() {
+    using Clock = std::chrono::steady_clock;
+    auto lastSync = Clock::now();
+    std::vector<std::pair<int, std::string>> batch;
+    std::vector<int> unsynced;  // Files written to since the last fsync
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait_for(lock, std::chrono::duration<double>(flushInterval),
+                      [this] { return stopping || requested > written || buffered >= batchBytes; });
+        long round = requested;
+        bool last = stopping;
+        batch.clear();
+        for (auto& f : files) {
+            if (f.buffer.empty()) continue;
+            batch.emplace_back(f.fd, std::string());
+            batch.back().second.swap(f.buffer);  // Leaves an empty buffer behind
+        }
+        buffered = 0;
+        lock.unlock();
+
+        for (auto& b : batch) {
+            const char* data = b.second.data();
+            std::size_t left = b.second.size();
+            while (left > 0) {
+                ssize_t n = write(b.first, data, left);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) {
+                    perror("observable output");
+                    exit(1);
+                }
+                data += n;
+                left -= n;
+            }
+
+            // Removing an output file stops the run, as it did when files were reopened per record
+            struct stat st;
+            if (fstat(b.first, &st) == 0 && st.st_nlink == 0) {
+                printf("output file deleted\n");
+                exit(1);
+            }
+            if (std::find(unsynced.begin(), unsynced.end(), b.first) == unsynced.end()) unsynced.push_back(b.first);
+        }
+
+        auto now = Clock::now();
+        if (syncInterval > 0 && (last || std::chrono::duration<double>(now - lastSync).count() >= syncInterval)) {
+            for (auto fd : unsynced) fsync(fd);
+            unsynced.clear();
+            lastSync = now;
+        }
+
+        lock.lock();
+        written = round;
+        done.notify_all();
+        if (last) return;
+    }
+}
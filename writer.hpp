@@ -0,0 +1,94 @@
+// Copyright 2020 Joren Brunekreef and Andrzej Görlich
+#pragma once    // Ensures this header is included only once during compilation
+
+/****
+ * OutputWriter collects the records of the observables of one Simulation
+ * and writes them from a background thread. Files are opened once and kept
+ * open. Records are appended to per-file buffers in memory. The thread
+ * writes all buffers at once when they hold batchBytes, when a record has
+ * waited flushInterval seconds, or when flush() is called. With
+ * syncInterval > 0 it also fsyncs the files that many seconds apart.
+ *
+ * append() may be called from any thread, e.g. by observables measured on
+ * worker threads. The thread is started by the first open().
+ ****/
+
+#include <chrono>               // Flush and sync cadence
+#include <condition_variable>   // Waking the writer, waiting in flush()
+#include <cstdint>              // File sizes
+#include <mutex>                // Guards the buffers
+#include <string>               // File names and records
+#include <thread>               // Background writer
+#include <vector>               // Open files
+
+class OutputWriter {
+public:
+    OutputWriter() = default;
+
+    // Writes what is buffered, syncs if syncInterval is set and closes the files
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Seconds between fsyncs of the files, 0 (default) leaves it to the OS
+    double syncInterval = 0;
+
+    // Seconds a record may wait in memory before it is written
+    double flushInterval = 1;
+
+    // Buffered bytes over all files that trigger a write
+    std::size_t batchBytes = 1 << 20;
+
+    // Creates or truncates a file and returns the id its records are appended to
+    // Opening a name that is already open truncates it again and returns the same id
+    // keep: bytes of an existing file to keep, to continue a run from a checkpoint;
+    // exits with a message if the file is shorter
+    int open(const std::string& filename, std::uint64_t keep = 0);
+
+    // Bytes appended to a file since open(), plus the bytes kept, written or not
+    std::uint64_t size(int file);
+
+    // Buffers record, followed by a newline, for the file with the given id
+    void append(int file, const std::string& record) { add(file, record.data(), record.size(), true); }
+
+    // Buffers size raw bytes for the file with the given id (binary records)
+    void append(int file, const void* data, std::size_t size) {
+        add(file, static_cast<const char*>(data), size, false);
+    }
+
+    // Blocks until every record appended so far is written
+    void flush();
+
+    // Like flush(), then fsyncs every file, so the records survive a crash
+    // (the Checkpointer calls it from its thread before it replaces a chain state that records the sizes)
+    void sync();
+
+private:
+    // An open file and the records not yet written to it
+    struct File {
+        std::string name;
+        int fd;
+        std::string buffer;
+        std::uint64_t size;     // Length of the file once buffer is written
+    };
+
+    // Guards everything below except thread
+    std::mutex mutex;
+    std::condition_variable wake;   // Signals the writer that there is work
+    std::condition_variable done;   // Signals flush() that a write round finished
+
+    std::vector<File> files;
+    std::size_t buffered = 0;       // Bytes in all buffers
+    long requested = 0;             // Number of flush() calls
+    long written = 0;               // Value of requested covered by the last write round
+    bool stopping = false;          // Set by the destructor
+
+    std::thread thread;
+
+    // Appends to a file's buffer and wakes the writer once a batch is full
+    void add(int file, const char* data, std::size_t size, bool newline);
+
+    // Main loop of the background thread
+    void run();
+};